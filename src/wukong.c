@@ -16,12 +16,20 @@
 
 // headers
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <math.h>
 #ifdef WIN64
 #include "windows.h"
 #else
 #include "sys/time.h"
 #include "sys/select.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+#include "fcntl.h"
+#include "time.h"
+#include "unistd.h"
 #include "string.h"
 #endif
 
@@ -90,16 +98,17 @@ int char_pieces[] = {
     ['k'] = k,
 };
 
-// decode promoted pieces
-int promoted_pieces[] = {
-    [Q] = 'q',
-    [R] = 'r',
-    [B] = 'b',
-    [N] = 'n',
-    [q] = 'q',
-    [r] = 'r',
-    [b] = 'b',
-    [n] = 'n',
+// decode promoted pieces (empty string for no promotion, so moves print without a NUL byte)
+char *promoted_pieces[] = {
+    [e] = "",
+    [Q] = "q",
+    [R] = "r",
+    [B] = "b",
+    [N] = "n",
+    [q] = "q",
+    [r] = "r",
+    [b] = "b",
+    [n] = "n",
 };
 
 // material scrore
@@ -239,8 +248,16 @@ const int mirror_score[128] =
 	a8, b8, c8, d8, e8, f8, g8, h8,    o, o, o, o, o, o, o, o
 };
 
+// material + positional score [piece][square] from white's perspective (see init_evaluation())
+int piece_square_score[13][128];
+
+/*
+    Board state and search heuristics below are declared thread local
+    (__thread) so that every search thread works on its private copy
+*/
+
 // chess board representation
-int board[128] = {
+__thread int board[128] = {
     r, n, b, q, k, b, n, r,  o, o, o, o, o, o, o, o,
     p, p, p, p, p, p, p, p,  o, o, o, o, o, o, o, o,
     e, e, e, e, e, e, e, e,  o, o, o, o, o, o, o, o,
@@ -252,16 +269,89 @@ int board[128] = {
 };
 
 // side to move
-int side = white;
+__thread int side = white;
 
 // enpassant square
-int enpassant = no_sq;
+__thread int enpassant = no_sq;
 
 // castling rights (dec 15 => bin 1111 => both kings can castle to both sides)
-int castle = 15;
+__thread int castle = 15;
 
 // kings' squares
-int king_square[2] = {e1, e8};
+__thread int king_square[2] = {e1, e8};
+
+// piece list [piece][index] (squares occupied by the given piece type)
+__thread int piece_list[13][10];
+
+// number of pieces of each type on board
+__thread int piece_count[13];
+
+// incrementally updated material & positional score from white's perspective
+__thread int static_score = 0;
+
+// almost unique position identifier aka hash key
+__thread unsigned long long hash_key = 0;
+
+// pawns placement identifier (pawn hash table key)
+__thread unsigned long long pawn_key = 0;
+
+// half move
+__thread int ply = 0;
+
+// half moves since the last capture or pawn move (fifty move rule)
+__thread int fifty = 0;
+
+// max number of half moves in a game (including search)
+#define max_game_ply 2048
+
+// max search ply
+#define max_ply 64
+
+// undo record (board state that can't be restored from the move itself)
+typedef struct {
+    // move made
+    int move;
+    
+    // captured piece
+    int captured_piece;
+    
+    // castling rights before the move
+    int castle;
+    
+    // enpassant square before the move
+    int enpassant;
+    
+    // moving side's king square before the move
+    int king_square;
+    
+    // fifty move counter before the move
+    int fifty;
+    
+    // hash key before the move (repetition detection)
+    unsigned long long hash_key;
+} undo;
+
+// undo stack
+__thread undo undo_stack[max_game_ply];
+
+// number of moves on undo stack
+__thread int undo_count = 0;
+
+// board state snapshot (passes position from one thread to another)
+typedef struct {
+    int board[128];
+    int side;
+    int enpassant;
+    int castle;
+    int king_square[2];
+    int static_score;
+    unsigned long long hash_key;
+    int fifty;
+    
+    // moves leading to the position (only the last "fifty" ones matter for repetitions)
+    undo history[100];
+    int history_count;
+} board_state;
 
 /*
     Move formatting
@@ -337,6 +427,386 @@ typedef struct {
 } moves;
 
 
+/***********************************************\
+
+                ZOBRIST HASHING
+
+\***********************************************/
+
+// random piece keys [piece][square]
+unsigned long long piece_keys[13][128];
+
+// random enpassant keys [square]
+unsigned long long enpassant_keys[128];
+
+// random castling keys [castle]
+unsigned long long castle_keys[16];
+
+// random side key
+unsigned long long side_key;
+
+// pseudo random number generator state
+unsigned long long random_state = 1070372ULL;
+
+// generate 64-bit pseudo random number (xorshift64*)
+unsigned long long get_random_number()
+{
+    // XOR shift algorithm
+    random_state ^= random_state >> 12;
+    random_state ^= random_state << 25;
+    random_state ^= random_state >> 27;
+
+    // scramble the result
+    return random_state * 2685821657736338717ULL;
+}
+
+// init random hash keys
+void init_hash_keys()
+{
+    // loop over board squares
+    for (int square = 0; square < 128; square++)
+    {
+        // if square is on board
+        if (!(square & 0x88))
+        {
+            // init random piece keys
+            for (int piece = P; piece <= k; piece++)
+                piece_keys[piece][square] = get_random_number();
+
+            // init random enpassant keys
+            enpassant_keys[square] = get_random_number();
+        }
+    }
+
+    // init random castling keys
+    for (int index = 0; index < 16; index++)
+        castle_keys[index] = get_random_number();
+
+    // init random side key
+    side_key = get_random_number();
+}
+
+// generate almost unique position ID aka hash key from scratch
+unsigned long long generate_hash_key()
+{
+    // final hash key
+    unsigned long long final_key = 0ULL;
+
+    // loop over board squares
+    for (int square = 0; square < 128; square++)
+    {
+        // if square is on board and is occupied
+        if (!(square & 0x88) && board[square])
+            // hash piece
+            final_key ^= piece_keys[board[square]][square];
+    }
+
+    // hash enpassant
+    if (enpassant != no_sq)
+        final_key ^= enpassant_keys[enpassant];
+
+    // hash castling rights
+    final_key ^= castle_keys[castle];
+
+    // hash the side only if black is to move
+    if (side == black)
+        final_key ^= side_key;
+
+    // return generated hash key
+    return final_key;
+}
+
+// generate pawn key
+unsigned long long generate_pawn_key()
+{
+    // final pawn key
+    unsigned long long final_key = 0ULL;
+
+    // loop over board squares
+    for (int square = 0; square < 128; square++)
+    {
+        // if square is on board and is occupied by pawn
+        if (!(square & 0x88) && (board[square] == P || board[square] == p))
+            // hash pawn
+            final_key ^= piece_keys[board[square]][square];
+    }
+
+    // return generated pawn key
+    return final_key;
+}
+
+
+/***********************************************\
+
+                MAGIC BITBOARDS
+
+\***********************************************/
+
+/*
+    Alternative board backend (build with -DBITBOARDS, see makefile).
+    
+    0x88 board stays the primary board representation (move encoding,
+    evaluation and UCI front end keep using 0x88 squares), bitboards are
+    maintained alongside it and are used by attack queries and move
+    generation. Bitboard squares are indexed a8 = 0 ... h1 = 63, e.g.
+    
+         0x88 square 0x74 (e1)  <=>  64 square 60
+*/
+
+#ifdef BITBOARDS
+
+// bitboard data type
+#define U64 unsigned long long
+
+// convert 0x88 square to 64 square index
+#define square_64(square) (((square) + ((square) & 7)) >> 1)
+
+// convert 64 square index to 0x88 square
+#define square_128(square) ((square) + ((square) & ~7))
+
+// set/get/pop bit macros
+#define set_bit(bitboard, square) ((bitboard) |= (1ULL << (square)))
+#define get_bit(bitboard, square) ((bitboard) & (1ULL << (square)))
+#define pop_bit(bitboard, square) ((bitboard) &= ~(1ULL << (square)))
+
+// count bits within a bitboard
+#define count_bits(bitboard) __builtin_popcountll(bitboard)
+
+// get least significant 1st bit index
+#define get_ls1b_index(bitboard) __builtin_ctzll(bitboard)
+
+// occupancy index for both sides
+#define both 2
+
+// piece bitboards [piece]
+__thread U64 bitboards[13];
+
+// occupancy bitboards [white/black/both]
+__thread U64 occupancies[3];
+
+// leaper pieces attack tables
+U64 pawn_attacks[2][64];
+U64 knight_attacks[64];
+U64 king_attacks[64];
+
+// relevant occupancy masks for slider pieces
+U64 bishop_masks[64];
+U64 rook_masks[64];
+
+// relevant occupancy bit counts for slider pieces
+int bishop_relevant_bits[64];
+int rook_relevant_bits[64];
+
+// slider pieces attack tables [square][magic index]
+U64 bishop_attacks[64][512];
+U64 rook_attacks[64][4096];
+
+// rook magic numbers
+const U64 rook_magic_numbers[64] = {
+    0x00800080221a4000ULL, 0x2040002000401000ULL, 0xa900090010422000ULL, 0x0200041140200a00ULL,
+    0x1001008040200810ULL, 0x0200100200080401ULL, 0x0280108002000100ULL, 0x0200041500802242ULL,
+    0x200a002080420100ULL, 0x400c808040002000ULL, 0x0216801001200080ULL, 0x8201001000082100ULL,
+    0x2c40800800800400ULL, 0x0060808002000400ULL, 0x9021800100800200ULL, 0x6601000040810002ULL,
+    0x2080004020004001ULL, 0x1010024000402009ULL, 0x2000808020001000ULL, 0x0026020040201208ULL,
+    0x5004008004080081ULL, 0x0100808004000200ULL, 0x0000040002100801ULL, 0x4800020010440389ULL,
+    0x6200400080008020ULL, 0x00a0008280400220ULL, 0x0040120200208040ULL, 0x1288002101001000ULL,
+    0x0800080080040080ULL, 0x32802008010410c0ULL, 0x4202020400100801ULL, 0x80c00042000c00a1ULL,
+    0x4080004081002100ULL, 0x2800804000802001ULL, 0x0040100080802000ULL, 0x0201000821001002ULL,
+    0x0008001009000500ULL, 0x400a001492006810ULL, 0x0012508804000142ULL, 0x8021000045000882ULL,
+    0x2000204000908002ULL, 0x0240100028006000ULL, 0x2880110020010040ULL, 0x0001021002210008ULL,
+    0x0008020004004040ULL, 0x0009000804010002ULL, 0x0014020001008080ULL, 0x9004304401820005ULL,
+    0x0000220100408200ULL, 0x0050401008200040ULL, 0x0201801000200480ULL, 0x6485022008100100ULL,
+    0x1008440008008280ULL, 0x0009000400080300ULL, 0x0020080110020400ULL, 0x8440802100004080ULL,
+    0x0000210046128001ULL, 0x10010240002a1081ULL, 0x0c81114008200501ULL, 0x004100281000a015ULL,
+    0x0032002008041002ULL, 0x3206000130082422ULL, 0x000c101801122084ULL, 0x0008084030840102ULL
+};
+
+// bishop magic numbers
+const U64 bishop_magic_numbers[64] = {
+    0x0820200080810049ULL, 0x0222040804a90040ULL, 0x1010042048400060ULL, 0x0044040088828020ULL,
+    0xa008484140300880ULL, 0x0002226020020080ULL, 0x0021011003a00484ULL, 0x0100442084202001ULL,
+    0x8046425848009880ULL, 0x0143021001120098ULL, 0x0000220204082000ULL, 0x2a80944400808880ULL,
+    0x0002811040400308ULL, 0x0040011048040108ULL, 0x0300410802110438ULL, 0x0200820504024200ULL,
+    0x0840881022080120ULL, 0x00020c7104080481ULL, 0x004400020802010cULL, 0x8018009028401000ULL,
+    0x0486000400a2000cULL, 0x2000200d00884002ULL, 0x0004000212020280ULL, 0x8000808030880801ULL,
+    0x5810880850200161ULL, 0x0030c80350210108ULL, 0x0206a40088254400ULL, 0xb284004004010102ULL,
+    0x1006840008802000ULL, 0x1c30010008825102ULL, 0x0084840001015800ULL, 0x0200410004440200ULL,
+    0x0210101308240c21ULL, 0x0040823000206402ULL, 0x2084040400020020ULL, 0x6801040401080120ULL,
+    0x1240010100111040ULL, 0x4800880040020111ULL, 0x0808020440048800ULL, 0x0001404200048200ULL,
+    0x2804100410040400ULL, 0x0001308820000400ULL, 0x90041042280d1002ULL, 0x1020820214010200ULL,
+    0x5600204410100102ULL, 0x0040008a04100080ULL, 0x8021010208840208ULL, 0x8230011040800101ULL,
+    0x40248c3008050200ULL, 0x2001010090042821ULL, 0x000080210808080cULL, 0x201820b041108000ULL,
+    0x204c141082020004ULL, 0x0880850810244000ULL, 0x004084c408861340ULL, 0x0811010104008000ULL,
+    0x2081120811041000ULL, 0x808c020200840504ULL, 0x0085210021080805ULL, 0x0090000200840402ULL,
+    0x0000800040104128ULL, 0x0000a08450220201ULL, 0x000041680804a292ULL, 0x0002022812108200ULL
+};
+
+// leaper piece attacks generated by walking 0x88 offsets
+U64 leaper_attacks_on_the_fly(int square, int *offsets, int count)
+{
+    // attacks bitboard
+    U64 attacks = 0ULL;
+    
+    // loop over move offsets
+    for (int index = 0; index < count; index++)
+    {
+        // init target square
+        int target_square = square_128(square) + offsets[index];
+        
+        // if target square is on board
+        if (!(target_square & 0x88))
+            set_bit(attacks, square_64(target_square));
+    }
+    
+    return attacks;
+}
+
+// slider piece attacks generated by walking 0x88 rays until they hit a blocker
+U64 slider_attacks_on_the_fly(int square, U64 block, int *offsets)
+{
+    // attacks bitboard
+    U64 attacks = 0ULL;
+    
+    // loop over ray offsets
+    for (int index = 0; index < 4; index++)
+    {
+        // loop over attack ray
+        for (int target_square = square_128(square) + offsets[index]; !(target_square & 0x88); target_square += offsets[index])
+        {
+            // add target square to attacks
+            set_bit(attacks, square_64(target_square));
+            
+            // break if hit a piece
+            if (get_bit(block, square_64(target_square)))
+                break;
+        }
+    }
+    
+    return attacks;
+}
+
+// relevant occupancy mask (slider rays without the board edge squares)
+U64 mask_slider_attacks(int square, int *offsets)
+{
+    // occupancy mask
+    U64 mask = 0ULL;
+    
+    // loop over ray offsets
+    for (int index = 0; index < 4; index++)
+    {
+        // loop over attack ray until the next square leaves the board
+        for (int target_square = square_128(square) + offsets[index]; !((target_square + offsets[index]) & 0x88); target_square += offsets[index])
+            set_bit(mask, square_64(target_square));
+    }
+    
+    return mask;
+}
+
+// map occupancy index onto the relevant occupancy mask
+U64 set_occupancy(int index, int bits_in_mask, U64 attack_mask)
+{
+    // occupancy map
+    U64 occupancy = 0ULL;
+    
+    // loop over the range of bits within attack mask
+    for (int count = 0; count < bits_in_mask; count++)
+    {
+        // get LS1B index of attacks mask
+        int square = get_ls1b_index(attack_mask);
+        
+        // pop LS1B in attack map
+        pop_bit(attack_mask, square);
+        
+        // make sure occupancy is on board
+        if (index & (1 << count))
+            // populate occupancy map
+            set_bit(occupancy, square);
+    }
+    
+    return occupancy;
+}
+
+// init attack tables
+void init_bitboards()
+{
+    // loop over 64 board squares
+    for (int square = 0; square < 64; square++)
+    {
+        // init pawn attacks (white pawns capture towards rank 8, black ones towards rank 1)
+        pawn_attacks[white][square] = leaper_attacks_on_the_fly(square, (int[]){-15, -17}, 2);
+        pawn_attacks[black][square] = leaper_attacks_on_the_fly(square, (int[]){15, 17}, 2);
+        
+        // init knight & king attacks
+        knight_attacks[square] = leaper_attacks_on_the_fly(square, knight_offsets, 8);
+        king_attacks[square] = leaper_attacks_on_the_fly(square, king_offsets, 8);
+        
+        // init slider masks
+        bishop_masks[square] = mask_slider_attacks(square, bishop_offsets);
+        rook_masks[square] = mask_slider_attacks(square, rook_offsets);
+        
+        // init relevant occupancy bit counts
+        bishop_relevant_bits[square] = count_bits(bishop_masks[square]);
+        rook_relevant_bits[square] = count_bits(rook_masks[square]);
+        
+        // loop over bishop occupancy variations
+        for (int index = 0; index < (1 << bishop_relevant_bits[square]); index++)
+        {
+            // init current occupancy variation
+            U64 occupancy = set_occupancy(index, bishop_relevant_bits[square], bishop_masks[square]);
+            
+            // init magic index
+            int magic_index = (occupancy * bishop_magic_numbers[square]) >> (64 - bishop_relevant_bits[square]);
+            
+            // init bishop attacks
+            bishop_attacks[square][magic_index] = slider_attacks_on_the_fly(square, occupancy, bishop_offsets);
+        }
+        
+        // loop over rook occupancy variations
+        for (int index = 0; index < (1 << rook_relevant_bits[square]); index++)
+        {
+            // init current occupancy variation
+            U64 occupancy = set_occupancy(index, rook_relevant_bits[square], rook_masks[square]);
+            
+            // init magic index
+            int magic_index = (occupancy * rook_magic_numbers[square]) >> (64 - rook_relevant_bits[square]);
+            
+            // init rook attacks
+            rook_attacks[square][magic_index] = slider_attacks_on_the_fly(square, occupancy, rook_offsets);
+        }
+    }
+}
+
+// get bishop attacks
+static inline U64 get_bishop_attacks(int square, U64 occupancy)
+{
+    // get bishop attacks assuming current board occupancy
+    occupancy &= bishop_masks[square];
+    occupancy *= bishop_magic_numbers[square];
+    occupancy >>= 64 - bishop_relevant_bits[square];
+    
+    return bishop_attacks[square][occupancy];
+}
+
+// get rook attacks
+static inline U64 get_rook_attacks(int square, U64 occupancy)
+{
+    // get rook attacks assuming current board occupancy
+    occupancy &= rook_masks[square];
+    occupancy *= rook_magic_numbers[square];
+    occupancy >>= 64 - rook_relevant_bits[square];
+    
+    return rook_attacks[square][occupancy];
+}
+
+// get queen attacks
+static inline U64 get_queen_attacks(int square, U64 occupancy)
+{
+    return get_bishop_attacks(square, occupancy) | get_rook_attacks(square, occupancy);
+}
+
+#endif
+
+
 /***********************************************\
 
                  BOARD FUNCTIONS
@@ -401,13 +871,152 @@ void print_move_list(moves *move_list)
     {
         int move = move_list->moves[index];
         printf("    %s%s", square_to_coords[get_move_source(move)], square_to_coords[get_move_target(move)]);
-        printf("%c    ", get_move_piece(move) ? promoted_pieces[get_move_piece(move)] : ' ');
+        printf("%s    ", get_move_piece(move) ? promoted_pieces[get_move_piece(move)] : " ");
         printf("%d        %d        %d        %d\n", get_move_capture(move), get_move_pawn(move), get_move_enpassant(move), get_move_castling(move));
     }
     
     printf("\n    Total moves: %d\n\n", move_list->count);
 }
 
+// put piece on empty square
+static inline void add_piece(int piece, int square)
+{
+    // hash piece
+    hash_key ^= piece_keys[piece][square];
+    
+    // hash pawn
+    if (piece == P || piece == p)
+        pawn_key ^= piece_keys[piece][square];
+    
+    // update material & positional score
+    static_score += piece_square_score[piece][square];
+    
+    // set piece on board
+    board[square] = piece;
+    
+    // append square to piece list
+    piece_list[piece][piece_count[piece]++] = square;
+    
+    #ifdef BITBOARDS
+        // set piece on bitboards
+        set_bit(bitboards[piece], square_64(square));
+        set_bit(occupancies[piece <= K ? white : black], square_64(square));
+        set_bit(occupancies[both], square_64(square));
+    #endif
+}
+
+// remove piece from square
+static inline void remove_piece(int square)
+{
+    // init piece
+    int piece = board[square];
+    
+    // hash piece
+    hash_key ^= piece_keys[piece][square];
+    
+    // hash pawn
+    if (piece == P || piece == p)
+        pawn_key ^= piece_keys[piece][square];
+    
+    // update material & positional score
+    static_score -= piece_square_score[piece][square];
+    
+    // clear square
+    board[square] = e;
+    
+    #ifdef BITBOARDS
+        // remove piece from bitboards
+        pop_bit(bitboards[piece], square_64(square));
+        pop_bit(occupancies[piece <= K ? white : black], square_64(square));
+        pop_bit(occupancies[both], square_64(square));
+    #endif
+    
+    // loop over piece list
+    for (int index = 0; index < piece_count[piece]; index++)
+    {
+        // if square is found
+        if (piece_list[piece][index] == square)
+        {
+            // replace it with the last square in the list
+            piece_list[piece][index] = piece_list[piece][--piece_count[piece]];
+            break;
+        }
+    }
+}
+
+// move piece to empty square
+static inline void move_piece(int from_square, int to_square)
+{
+    // init piece
+    int piece = board[from_square];
+    
+    // hash piece
+    hash_key ^= piece_keys[piece][from_square];
+    hash_key ^= piece_keys[piece][to_square];
+    
+    // hash pawn
+    if (piece == P || piece == p)
+        pawn_key ^= piece_keys[piece][from_square] ^ piece_keys[piece][to_square];
+    
+    // update material & positional score
+    static_score += piece_square_score[piece][to_square] - piece_square_score[piece][from_square];
+    
+    // move piece on board
+    board[to_square] = piece;
+    board[from_square] = e;
+    
+    #ifdef BITBOARDS
+        // move piece on bitboards
+        U64 from_to = (1ULL << square_64(from_square)) | (1ULL << square_64(to_square));
+        bitboards[piece] ^= from_to;
+        occupancies[piece <= K ? white : black] ^= from_to;
+        occupancies[both] ^= from_to;
+    #endif
+    
+    // loop over piece list
+    for (int index = 0; index < piece_count[piece]; index++)
+    {
+        // if source square is found
+        if (piece_list[piece][index] == from_square)
+        {
+            // update piece's square
+            piece_list[piece][index] = to_square;
+            break;
+        }
+    }
+}
+
+// init piece lists from board
+void init_piece_lists()
+{
+    // reset piece counts
+    memset(piece_count, 0, sizeof(piece_count));
+    
+    #ifdef BITBOARDS
+        // reset bitboards
+        memset(bitboards, 0, sizeof(bitboards));
+        memset(occupancies, 0, sizeof(occupancies));
+    #endif
+    
+    // loop over board squares
+    for (int square = 0; square < 128; square++)
+    {
+        // if square is on board and is occupied
+        if (!(square & 0x88) && board[square])
+        {
+            // append square to piece list
+            piece_list[board[square]][piece_count[board[square]]++] = square;
+            
+            #ifdef BITBOARDS
+                // set piece on bitboards
+                set_bit(bitboards[board[square]], square_64(square));
+                set_bit(occupancies[board[square] <= K ? white : black], square_64(square));
+                set_bit(occupancies[both], square_64(square));
+            #endif
+        }
+    }
+}
+
 // reset board
 void reset_board()
 {
@@ -427,6 +1036,24 @@ void reset_board()
         }
     }
     
+    // reset piece counts
+    memset(piece_count, 0, sizeof(piece_count));
+    
+    #ifdef BITBOARDS
+        // reset bitboards
+        memset(bitboards, 0, sizeof(bitboards));
+        memset(occupancies, 0, sizeof(occupancies));
+    #endif
+    
+    // reset material & positional score
+    static_score = 0;
+    
+    // reset undo stack
+    undo_count = 0;
+    
+    // reset fifty move counter
+    fifty = 0;
+    
     // reset stats
     side = -1;
     castle = 0;
@@ -462,7 +1089,7 @@ void parse_fen(char *fen)
                         king_square[black] = square;
                     
                     // set the piece on board
-                    board[square] = char_pieces[*fen];
+                    add_piece(char_pieces[*fen], square);
                     
                     // increment FEN pointer
                     *fen++;
@@ -534,7 +1161,63 @@ void parse_fen(char *fen)
     }
     
     else
-        enpassant = no_sq;   
+        enpassant = no_sq;
+    
+    // go to half move clock parsing
+    while (*fen && *fen != ' ')
+        fen++;
+    
+    // parse half move clock (full move number isn't needed)
+    fifty = atoi(fen);
+    
+    // init hash key
+    hash_key = generate_hash_key();
+    
+    // init pawn key
+    pawn_key = generate_pawn_key();
+}
+
+// save board state
+void save_board_state(board_state *state)
+{
+    memcpy(state->board, board, sizeof(board));
+    memcpy(state->king_square, king_square, sizeof(king_square));
+    state->side = side;
+    state->enpassant = enpassant;
+    state->castle = castle;
+    state->hash_key = hash_key;
+    state->static_score = static_score;
+    state->fifty = fifty;
+    
+    // positions before the last irreversible move can't repeat
+    state->history_count = fifty < undo_count ? fifty : undo_count;
+    
+    if (state->history_count > 100)
+        state->history_count = 100;
+    
+    // copy moves leading to the position
+    memcpy(state->history, &undo_stack[undo_count - state->history_count], state->history_count * sizeof(undo));
+}
+
+// restore board state
+void restore_board_state(board_state *state)
+{
+    memcpy(board, state->board, sizeof(board));
+    memcpy(king_square, state->king_square, sizeof(king_square));
+    side = state->side;
+    enpassant = state->enpassant;
+    castle = state->castle;
+    hash_key = state->hash_key;
+    static_score = state->static_score;
+    fifty = state->fifty;
+    pawn_key = generate_pawn_key();
+    
+    // reset undo stack to the moves leading to the position
+    memcpy(undo_stack, state->history, state->history_count * sizeof(undo));
+    undo_count = state->history_count;
+    
+    // init piece lists
+    init_piece_lists();
 }
 
 
@@ -544,120 +1227,142 @@ void parse_fen(char *fen)
 
 \***********************************************/
 
-// is square attacked
-static inline int is_square_attacked(int square, int side)
+/*
+    0x88 attack & delta tables: difference of two 0x88 squares uniquely
+    identifies their geometric relation, so tables indexed by
+    (attacker square - target square + 119) tell which piece types could
+    attack the target from the attacker's square and which step leads from
+    the target towards the attacker along a line
+*/
+
+// piece type bits in attack table
+enum attack_bits {
+    white_pawn_attack = 1, black_pawn_attack = 2, knight_attack = 4, bishop_attack = 8,
+    rook_attack = 16, queen_attack = 32, king_attack = 64
+};
+
+// attack table [attacker - target + 119]
+int attack_table[240];
+
+// delta table [attacker - target + 119] (step from target towards attacker, 0 if not on a line)
+int delta_table[240];
+
+// attack bits of pieces
+int piece_attack_bits[13] = {
+    0, white_pawn_attack, knight_attack, bishop_attack, rook_attack, queen_attack, king_attack,
+    black_pawn_attack, knight_attack, bishop_attack, rook_attack, queen_attack, king_attack
+};
+
+// init attack & delta tables
+void init_attack_tables()
 {
-    // pawn attacks
-    if (!side)
-    {
-        // if target square is on board and is white pawn
-        if (!((square + 17) & 0x88) && (board[square + 17] == P))
-            return 1;
-        
-        // if target square is on board and is white pawn
-        if (!((square + 15) & 0x88) && (board[square + 15] == P))
-            return 1;
-    }
+    // pawn attacks (white pawns attack upwards, so they stand below the target)
+    attack_table[15 + 119] |= white_pawn_attack;
+    attack_table[17 + 119] |= white_pawn_attack;
+    attack_table[-15 + 119] |= black_pawn_attack;
+    attack_table[-17 + 119] |= black_pawn_attack;
     
-    else
+    // leaper attacks
+    for (int index = 0; index < 8; index++)
     {
-        // if target square is on board and is black pawn
-        if (!((square - 17) & 0x88) && (board[square - 17] == p))
-            return 1;
-        
-        // if target square is on board and is black pawn
-        if (!((square - 15) & 0x88) && (board[square - 15] == p))
-            return 1;
+        attack_table[knight_offsets[index] + 119] |= knight_attack;
+        attack_table[king_offsets[index] + 119] |= king_attack;
     }
     
-    // knight attacks
-    for (int index = 0; index < 8; index++)
+    // slider attacks
+    for (int index = 0; index < 4; index++)
     {
-        // init target square
-        int target_square = square + knight_offsets[index];
-        
-        // lookup target piece
-        int target_piece = board[target_square];
-        
-        // if target square is on board
-        if (!(target_square & 0x88))
+        // loop over distances
+        for (int distance = 1; distance < 8; distance++)
         {
-            if (!side ? target_piece == N : target_piece == n)
-                return 1;
-        } 
+            // bishop & queen diagonals
+            attack_table[bishop_offsets[index] * distance + 119] |= bishop_attack | queen_attack;
+            delta_table[bishop_offsets[index] * distance + 119] = bishop_offsets[index];
+            
+            // rook & queen lines
+            attack_table[rook_offsets[index] * distance + 119] |= rook_attack | queen_attack;
+            delta_table[rook_offsets[index] * distance + 119] = rook_offsets[index];
+        }
     }
-    
-    // king attacks
-    for (int index = 0; index < 8; index++)
+}
+
+#ifndef BITBOARDS
+
+// is square attacked (only pieces on matching lines or leaper squares are tested)
+static inline int is_square_attacked(int square, int side)
+{
+    // loop over attacking side's piece types
+    for (int piece = !side ? P : p; piece <= (!side ? K : k); piece++)
     {
-        // init target square
-        int target_square = square + king_offsets[index];
-        
-        // lookup target piece
-        int target_piece = board[target_square];
+        // init piece type bits
+        int bits = piece_attack_bits[piece];
         
-        // if target square is on board
-        if (!(target_square & 0x88))
+        // loop over pieces of the current type
+        for (int count = 0; count < piece_count[piece]; count++)
         {
-            // if target piece is either white or black king
-            if (!side ? target_piece == K : target_piece == k)
+            // init attacker square & table index
+            int attacker_square = piece_list[piece][count];
+            int index = attacker_square - square + 119;
+            
+            // piece can't attack the square from where it stands
+            if (!(attack_table[index] & bits))
+                continue;
+            
+            // leapers attack straight away
+            if (!delta_table[index] || bits & (white_pawn_attack | black_pawn_attack | king_attack))
                 return 1;
-        } 
-    }
-    
-    // bishop & queen attacks
-    for (int index = 0; index < 4; index++)
-    {
-        // init target square
-        int target_square = square + bishop_offsets[index];
-        
-        // loop over attack ray
-        while (!(target_square & 0x88))
-        {
-            // target piece
-            int target_piece = board[target_square];
             
-            // if target piece is either white or black bishop or queen
-            if (!side ? (target_piece == B || target_piece == Q) : (target_piece == b || target_piece == q))
+            // init step from target towards slider
+            int step = delta_table[index];
+            int ray_square = square + step;
+            
+            // skip empty squares in between
+            while (ray_square != attacker_square && !board[ray_square])
+                ray_square += step;
+            
+            // nothing blocks the slider
+            if (ray_square == attacker_square)
                 return 1;
-
-            // break if hit a piece
-            if (target_piece)
-                break;
-        
-            // increment target square by move offset
-            target_square += bishop_offsets[index];
         }
     }
     
-    // rook & queen attacks
-    for (int index = 0; index < 4; index++)
-    {
-        // init target square
-        int target_square = square + rook_offsets[index];
-        
-        // loop over attack ray
-        while (!(target_square & 0x88))
-        {
-            // target piece
-            int target_piece = board[target_square];
-            
-            // if target piece is either white or black bishop or queen
-            if (!side ? (target_piece == R || target_piece == Q) : (target_piece == r || target_piece == q))
-                return 1;
+    // by default return false
+    return 0;
+}
 
-            // break if hit a piece
-            if (target_piece)
-                break;
-        
-            // increment target square by move offset
-            target_square += rook_offsets[index];
-        }
-    }
+#else
+
+// is square attacked (bitboard backend)
+static inline int is_square_attacked(int square, int side)
+{
+    // convert 0x88 square to bitboard square
+    square = square_64(square);
+    
+    // pawn attacks (pawns attacking the square stand where opposite side pawn on that square would capture)
+    if (pawn_attacks[side ^ 1][square] & bitboards[!side ? P : p])
+        return 1;
+    
+    // knight attacks
+    if (knight_attacks[square] & bitboards[!side ? N : n])
+        return 1;
+    
+    // bishop & queen attacks
+    if (get_bishop_attacks(square, occupancies[both]) & (!side ? (bitboards[B] | bitboards[Q]) : (bitboards[b] | bitboards[q])))
+        return 1;
+    
+    // rook & queen attacks
+    if (get_rook_attacks(square, occupancies[both]) & (!side ? (bitboards[R] | bitboards[Q]) : (bitboards[r] | bitboards[q])))
+        return 1;
+    
+    // king attacks
+    if (king_attacks[square] & bitboards[!side ? K : k])
+        return 1;
     
     return 0;
 }
 
+#endif
+
 // print attack map
 void print_attacked_squares(int side)
 {
@@ -702,18 +1407,23 @@ static inline void add_move(moves *move_list, int move)
 }
 
 
+#ifndef BITBOARDS
+
 // move generator
 static inline void generate_moves(moves *move_list)
 {
     // reset move count
     move_list->count = 0;
 
-    // loop over all board squares
-    for (int square = 0; square < 128; square++)
+    // loop over side to move's piece types
+    for (int piece = !side ? P : p; piece <= (!side ? K : k); piece++)
     {
-        // check if the square is on board
-        if (!(square & 0x88))
+        // loop over squares occupied by current piece type
+        for (int count = 0; count < piece_count[piece]; count++)
         {
+            // init square
+            int square = piece_list[piece][count];
+            
             // white pawn and castling moves
             if (!side)
             {
@@ -1071,725 +1781,6068 @@ static inline void generate_moves(moves *move_list)
     }
 }
 
-// copy/restore board position macros
-#define copy_board()                                \
-    int board_copy[128], king_square_copy[2];       \
-    int side_copy, enpassant_copy, castle_copy;     \
-    memcpy(board_copy, board, 512);                 \
-    side_copy = side;                               \
-    enpassant_copy = enpassant;                     \
-    castle_copy = castle;                           \
-    memcpy(king_square_copy, king_square,8);        \
+// captures and promotions generator (tactical moves for quiescence search)
+static inline void generate_captures(moves *move_list)
+{
+    // reset move count
+    move_list->count = 0;
+
+    // loop over side to move's piece types
+    for (int piece = !side ? P : p; piece <= (!side ? K : k); piece++)
+    {
+        // loop over squares occupied by current piece type
+        for (int count = 0; count < piece_count[piece]; count++)
+        {
+            // init square
+            int square = piece_list[piece][count];
+            
+            // white pawn moves
+            if (piece == P)
+            {
+                // init target square
+                int to_square = square - 16;
+                
+                // quiet pawn promotions
+                if ((square >= a7 && square <= h7) && !board[to_square])
+                {
+                    add_move(move_list, encode_move(square, to_square, Q, 0, 0, 0, 0));
+                    add_move(move_list, encode_move(square, to_square, R, 0, 0, 0, 0));
+                    add_move(move_list, encode_move(square, to_square, B, 0, 0, 0, 0));
+                    add_move(move_list, encode_move(square, to_square, N, 0, 0, 0, 0));
+                }
+                
+                // white pawn capture moves (offsets -15 & -17)
+                for (int index = 2; index < 4; index++)
+                {
+                    // init target square
+                    int to_square = square + bishop_offsets[index];
+                    
+                    // check if target square is on board
+                    if (!(to_square & 0x88))
+                    {
+                        // capture pawn promotion
+                        if (
+                             (square >= a7 && square <= h7) &&
+                             (board[to_square] >= 7 && board[to_square] <= 12)
+                           )
+                        {
+                            add_move(move_list, encode_move(square, to_square, Q, 1, 0, 0, 0));
+                            add_move(move_list, encode_move(square, to_square, R, 1, 0, 0, 0));
+                            add_move(move_list, encode_move(square, to_square, B, 1, 0, 0, 0));
+                            add_move(move_list, encode_move(square, to_square, N, 1, 0, 0, 0));
+                        }
+                        
+                        else
+                        {
+                            // casual capture
+                            if (board[to_square] >= 7 && board[to_square] <= 12)
+                                add_move(move_list, encode_move(square, to_square, 0, 1, 0, 0, 0));
+                            
+                            // enpassant capture
+                            if (to_square == enpassant)
+                                add_move(move_list, encode_move(square, to_square, 0, 1, 0, 1, 0));
+                        }
+                    }
+                }
+            }
+            
+            // black pawn moves
+            else if (piece == p)
+            {
+                // init target square
+                int to_square = square + 16;
+                
+                // quiet pawn promotions
+                if ((square >= a2 && square <= h2) && !board[to_square])
+                {
+                    add_move(move_list, encode_move(square, to_square, q, 0, 0, 0, 0));
+                    add_move(move_list, encode_move(square, to_square, r, 0, 0, 0, 0));
+                    add_move(move_list, encode_move(square, to_square, b, 0, 0, 0, 0));
+                    add_move(move_list, encode_move(square, to_square, n, 0, 0, 0, 0));
+                }
+                
+                // black pawn capture moves (offsets 15 & 17)
+                for (int index = 0; index < 2; index++)
+                {
+                    // init target square
+                    int to_square = square + bishop_offsets[index];
+                    
+                    // check if target square is on board
+                    if (!(to_square & 0x88))
+                    {
+                        // capture pawn promotion
+                        if (
+                             (square >= a2 && square <= h2) &&
+                             (board[to_square] >= 1 && board[to_square] <= 6)
+                           )
+                        {
+                            add_move(move_list, encode_move(square, to_square, q, 1, 0, 0, 0));
+                            add_move(move_list, encode_move(square, to_square, r, 1, 0, 0, 0));
+                            add_move(move_list, encode_move(square, to_square, b, 1, 0, 0, 0));
+                            add_move(move_list, encode_move(square, to_square, n, 1, 0, 0, 0));
+                        }
+                        
+                        else
+                        {
+                            // casual capture
+                            if (board[to_square] >= 1 && board[to_square] <= 6)
+                                add_move(move_list, encode_move(square, to_square, 0, 1, 0, 0, 0));
+                            
+                            // enpassant capture
+                            if (to_square == enpassant)
+                                add_move(move_list, encode_move(square, to_square, 0, 1, 0, 1, 0));
+                        }
+                    }
+                }
+            }
+            
+            // knight & king captures
+            else if (piece == N || piece == n || piece == K || piece == k)
+            {
+                // init move offsets
+                int *offsets = (piece == N || piece == n) ? knight_offsets : king_offsets;
+                
+                // loop over move offsets
+                for (int index = 0; index < 8; index++)
+                {
+                    // init target square
+                    int to_square = square + offsets[index];
+                    
+                    // make sure target square is onboard and holds opponent's piece
+                    if (!(to_square & 0x88) && (!side ? (board[to_square] >= 7 && board[to_square] <= 12) :
+                                                        (board[to_square] >= 1 && board[to_square] <= 6)))
+                        add_move(move_list, encode_move(square, to_square, 0, 1, 0, 0, 0));
+                }
+            }
+            
+            // sliding pieces captures
+            else
+            {
+                // loop over bishop & rook offsets
+                for (int index = 0; index < 8; index++)
+                {
+                    // init ray offset (king offsets hold rook offsets followed by bishop ones)
+                    int offset = king_offsets[index];
+                    
+                    // bishops don't move along ranks & files, rooks don't move diagonally
+                    if ((index < 4 && (piece == B || piece == b)) || (index >= 4 && (piece == R || piece == r)))
+                        continue;
+                    
+                    // init target square
+                    int to_square = square + offset;
+                    
+                    // skip empty squares along the ray
+                    while (!(to_square & 0x88) && !board[to_square])
+                        to_square += offset;
+                    
+                    // if ray hits opponent's piece
+                    if (!(to_square & 0x88) && (!side ? (board[to_square] >= 7 && board[to_square] <= 12) :
+                                                        (board[to_square] >= 1 && board[to_square] <= 6)))
+                        add_move(move_list, encode_move(square, to_square, 0, 1, 0, 0, 0));
+                }
+            }
+        }
+    }
+}
+
+#else
 
-#define take_back()                                 \
-    memcpy(board, board_copy, 512);                 \
-    side = side_copy;                               \
-    enpassant = enpassant_copy;                     \
-    castle = castle_copy;                           \
-    memcpy(king_square, king_square_copy,8);        \
+// get non-pawn piece attacks (bitboard backend)
+static inline U64 get_piece_attacks(int piece, int square)
+{
+    // switch piece type regardless of its color
+    switch (piece <= K ? piece : piece - 6)
+    {
+        case N: return knight_attacks[square];
+        case B: return get_bishop_attacks(square, occupancies[both]);
+        case R: return get_rook_attacks(square, occupancies[both]);
+        case Q: return get_queen_attacks(square, occupancies[both]);
+        case K: return king_attacks[square];
+    }
+    
+    return 0ULL;
+}
 
-// make move
-static inline int make_move(int move, int capture_flag)
+// generate pawn moves (bitboard backend)
+static inline void generate_pawn_moves(moves *move_list, int only_tactical)
 {
-    // quiet move
-    if (capture_flag == all_moves)
+    // pawn push direction
+    int direction = !side ? -8 : 8;
+    
+    // promoted pieces of the side to move
+    int queen = !side ? Q : q, rook = !side ? R : r, bishop = !side ? B : b, knight = !side ? N : n;
+    
+    // init pawns bitboard
+    U64 bitboard = bitboards[!side ? P : p];
+    
+    // loop over pawns
+    while (bitboard)
     {
-        // copy board state
-        copy_board();
+        // init source & target squares
+        int source_square = get_ls1b_index(bitboard);
+        int target_square = source_square + direction;
         
-        // parse move
-        int from_square = get_move_source(move);
-        int to_square = get_move_target(move);
-        int promoted_piece = get_move_piece(move);
-        int enpass = get_move_enpassant(move);
-        int double_push = get_move_pawn(move);
-        int castling = get_move_castling(move);
+        // is pawn about to promote
+        int promotion = !side ? (source_square >= 8 && source_square <= 15) : (source_square >= 48 && source_square <= 55);
         
-        // move piece
-        board[to_square] = board[from_square];
-        board[from_square] = e;
+        // is pawn on its initial rank
+        int initial = !side ? (source_square >= 48 && source_square <= 55) : (source_square >= 8 && source_square <= 15);
         
-        // pawn promotion
-        if (promoted_piece)
-            board[to_square] = promoted_piece;
-        
-        // enpassant capture
-        if (enpass)
-            !side ? (board[to_square + 16] = e) : (board[to_square - 16] = e);
-        
-        // reset enpassant square
-        enpassant = no_sq;
-        
-        // double pawn push
-        if (double_push)
-            !side ? (enpassant = to_square + 16) : (enpassant = to_square - 16);
-        
-        // castling
-        if (castling)
-        {
-            // switch target square
-            switch(to_square) {
-                // white castles king side
-                case g1:
-                    board[f1] = board[h1];
-                    board[h1] = e;
-                    break;
+        // quiet pawn moves (pawns never stand on the last rank, so target square is on board)
+        if (!get_bit(occupancies[both], target_square))
+        {
+            // pawn promotions
+            if (promotion)
+            {
+                add_move(move_list, encode_move(square_128(source_square), square_128(target_square), queen, 0, 0, 0, 0));
+                add_move(move_list, encode_move(square_128(source_square), square_128(target_square), rook, 0, 0, 0, 0));
+                add_move(move_list, encode_move(square_128(source_square), square_128(target_square), bishop, 0, 0, 0, 0));
+                add_move(move_list, encode_move(square_128(source_square), square_128(target_square), knight, 0, 0, 0, 0));
+            }
+            
+            else if (!only_tactical)
+            {
+                // one square ahead pawn move
+                add_move(move_list, encode_move(square_128(source_square), square_128(target_square), 0, 0, 0, 0, 0));
                 
-                // white castles queen side
-                case c1:
-                    board[d1] = board[a1];
-                    board[a1] = e;
-                    break;
-               
-               // black castles king side
-                case g8:
-                    board[f8] = board[h8];
-                    board[h8] = e;
-                    break;
-               
-               // black castles queen side
-                case c8:
-                    board[d8] = board[a8];
-                    board[a8] = e;
-                    break;
+                // two squares ahead pawn move
+                if (initial && !get_bit(occupancies[both], target_square + direction))
+                    add_move(move_list, encode_move(square_128(source_square), square_128(target_square + direction), 0, 0, 1, 0, 0));
             }
         }
         
-        // update king square
-        if (board[to_square] == K || board[to_square] == k)
-            king_square[side] = to_square;
+        // pawn captures
+        U64 attacks = pawn_attacks[side][source_square] & occupancies[side ^ 1];
+        
+        // loop over captured pieces
+        while (attacks)
+        {
+            // init target square
+            target_square = get_ls1b_index(attacks);
+            
+            // capture pawn promotion
+            if (promotion)
+            {
+                add_move(move_list, encode_move(square_128(source_square), square_128(target_square), queen, 1, 0, 0, 0));
+                add_move(move_list, encode_move(square_128(source_square), square_128(target_square), rook, 1, 0, 0, 0));
+                add_move(move_list, encode_move(square_128(source_square), square_128(target_square), bishop, 1, 0, 0, 0));
+                add_move(move_list, encode_move(square_128(source_square), square_128(target_square), knight, 1, 0, 0, 0));
+            }
+            
+            // casual capture
+            else
+                add_move(move_list, encode_move(square_128(source_square), square_128(target_square), 0, 1, 0, 0, 0));
+            
+            // pop captured piece
+            pop_bit(attacks, target_square);
+        }
         
-        // update castling rights
-        castle &= castling_rights[from_square];
-        castle &= castling_rights[to_square];
+        // enpassant capture
+        if (enpassant != no_sq && get_bit(pawn_attacks[side][source_square], square_64(enpassant)))
+            add_move(move_list, encode_move(square_128(source_square), enpassant, 0, 1, 0, 1, 0));
         
-        // change side
-        side ^= 1;
+        // pop current pawn
+        pop_bit(bitboard, source_square);
+    }
+}
+
+// generate piece moves (bitboard backend)
+static inline void generate_piece_moves(moves *move_list, int only_tactical)
+{
+    // target squares mask (empty or opponent's squares, only opponent's ones for tactical moves)
+    U64 targets = only_tactical ? occupancies[side ^ 1] : ~occupancies[side];
+    
+    // loop over side to move's non-pawn piece types
+    for (int piece = !side ? N : n; piece <= (!side ? K : k); piece++)
+    {
+        // init piece bitboard
+        U64 bitboard = bitboards[piece];
         
-        // take move back if king is under the check
-        if (is_square_attacked(!side ? king_square[side ^ 1] : king_square[side ^ 1], side))
+        // loop over pieces
+        while (bitboard)
         {
-            // restore board state
-            take_back();
+            // init source square
+            int source_square = get_ls1b_index(bitboard);
             
-            // illegal move
-            return 0;
+            // init piece attacks
+            U64 attacks = get_piece_attacks(piece, source_square) & targets;
+            
+            // loop over target squares
+            while (attacks)
+            {
+                // init target square
+                int target_square = get_ls1b_index(attacks);
+                
+                // is target square occupied by opponent's piece
+                int capture = get_bit(occupancies[side ^ 1], target_square) ? 1 : 0;
+                
+                // capture or quiet move
+                add_move(move_list, encode_move(square_128(source_square), square_128(target_square), 0, capture, 0, 0, 0));
+                
+                // pop target square
+                pop_bit(attacks, target_square);
+            }
+            
+            // pop current piece
+            pop_bit(bitboard, source_square);
+        }
+    }
+}
+
+// move generator (bitboard backend)
+static inline void generate_moves(moves *move_list)
+{
+    // reset move count
+    move_list->count = 0;
+    
+    // generate pawn & piece moves
+    generate_pawn_moves(move_list, all_moves);
+    generate_piece_moves(move_list, all_moves);
+    
+    // white king castling
+    if (!side)
+    {
+        // if king side castling is available
+        if (castle & KC)
+        {
+            // make sure there are empty squares between king & rook
+            if (!board[f1] && !board[g1])
+            {
+                // make sure king & next square are not under attack
+                if (!is_square_attacked(e1, black) && !is_square_attacked(f1, black))
+                    add_move(move_list, encode_move(e1, g1, 0, 0, 0, 0, 1));
+            }
         }
         
-        else
-            // legal move
-            return 1;
+        // if queen side castling is available
+        if (castle & QC)
+        {
+            // make sure there are empty squares between king & rook
+            if (!board[d1] && !board[b1] && !board[c1])
+            {
+                // make sure king & next square are not under attack
+                if (!is_square_attacked(e1, black) && !is_square_attacked(d1, black))
+                    add_move(move_list, encode_move(e1, c1, 0, 0, 0, 0, 1));
+            }
+        }
     }
     
-    // capture move
+    // black king castling
     else
     {
-        // if move is a capture
-        if (get_move_capture(move))
-            // make capture move
-            make_move(move, all_moves);
+        // if king side castling is available
+        if (castle & kc)
+        {
+            // make sure there are empty squares between king & rook
+            if (!board[f8] && !board[g8])
+            {
+                // make sure king & next square are not under attack
+                if (!is_square_attacked(e8, white) && !is_square_attacked(f8, white))
+                    add_move(move_list, encode_move(e8, g8, 0, 0, 0, 0, 1));
+            }
+        }
         
-        else
-            // move is not a capture
-            return 0;
+        // if queen side castling is available
+        if (castle & qc)
+        {
+            // make sure there are empty squares between king & rook
+            if (!board[d8] && !board[b8] && !board[c8])
+            {
+                // make sure king & next square are not under attack
+                if (!is_square_attacked(e8, white) && !is_square_attacked(d8, white))
+                    add_move(move_list, encode_move(e8, c8, 0, 0, 0, 0, 1));
+            }
+        }
     }
 }
 
+// captures and promotions generator (bitboard backend)
+static inline void generate_captures(moves *move_list)
+{
+    // reset move count
+    move_list->count = 0;
+    
+    // generate pawn & piece tactical moves
+    generate_pawn_moves(move_list, only_captures);
+    generate_piece_moves(move_list, only_captures);
+}
 
-/***********************************************\
-
-                  PERFT FUNCTIONS
+#endif
+
+// check if the move could be generated in the current position (hash and killer moves come from other positions)
+static inline int is_pseudo_legal(int move)
+{
+    // init move
+    int source_square = get_move_source(move);
+    int target_square = get_move_target(move);
+    int promoted_piece = get_move_piece(move);
+    int capture = get_move_capture(move);
+    
+    // squares must be on board
+    if ((source_square & 0x88) || (target_square & 0x88))
+        return 0;
+    
+    // init moving & target square pieces
+    int piece = board[source_square];
+    int target_piece = board[target_square];
+    
+    // side to move's piece has to stand on the source square
+    if (!piece || (piece >= p) != side)
+        return 0;
+    
+    // target square can't be occupied by own piece
+    if (target_piece && (target_piece >= p) == side)
+        return 0;
+    
+    // piece type regardless of its color
+    int type = piece <= K ? piece : piece - 6;
+    
+    // castling moves
+    if (get_move_castling(move))
+    {
+        // make sure the same castling move would be generated
+        moves move_list[1];
+        move_list->count = 0;
+        
+        // white king castling
+        if (!side && source_square == e1)
+        {
+            if ((castle & KC) && !board[f1] && !board[g1] && !is_square_attacked(e1, black) && !is_square_attacked(f1, black))
+                add_move(move_list, encode_move(e1, g1, 0, 0, 0, 0, 1));
+            
+            if ((castle & QC) && !board[d1] && !board[b1] && !board[c1] && !is_square_attacked(e1, black) && !is_square_attacked(d1, black))
+                add_move(move_list, encode_move(e1, c1, 0, 0, 0, 0, 1));
+        }
+        
+        // black king castling
+        else if (side && source_square == e8)
+        {
+            if ((castle & kc) && !board[f8] && !board[g8] && !is_square_attacked(e8, white) && !is_square_attacked(f8, white))
+                add_move(move_list, encode_move(e8, g8, 0, 0, 0, 0, 1));
+            
+            if ((castle & qc) && !board[d8] && !board[b8] && !board[c8] && !is_square_attacked(e8, white) && !is_square_attacked(d8, white))
+                add_move(move_list, encode_move(e8, c8, 0, 0, 0, 0, 1));
+        }
+        
+        // castling move is one of the generated ones
+        for (int count = 0; count < move_list->count; count++)
+            if (move_list->moves[count] == move)
+                return type == K;
+        
+        return 0;
+    }
+    
+    // pawn moves
+    if (type == P)
+    {
+        // pawn push direction
+        int direction = !side ? -16 : 16;
+        
+        // is pawn about to promote
+        int promotion = !side ? (source_square >= a7 && source_square <= h7) : (source_square >= a2 && source_square <= h2);
+        
+        // promotions must be encoded with side to move's queen, rook, bishop or knight
+        if (promotion != (promoted_piece != 0))
+            return 0;
+        
+        if (promoted_piece && (promoted_piece < (!side ? N : n) || promoted_piece > (!side ? Q : q)))
+            return 0;
+        
+        // enpassant capture
+        if (get_move_enpassant(move))
+            return capture && !get_move_pawn(move) && target_square == enpassant &&
+                   (target_square == source_square + direction - 1 || target_square == source_square + direction + 1);
+        
+        // capture flag must match target square
+        if (capture != (target_piece != e))
+            return 0;
+        
+        // double pawn push
+        if (get_move_pawn(move))
+            return !capture && target_square == source_square + direction * 2 && !board[source_square + direction] &&
+                   (!side ? (source_square >= a2 && source_square <= h2) : (source_square >= a7 && source_square <= h7));
+        
+        // pawn capture
+        if (capture)
+            return target_square == source_square + direction - 1 || target_square == source_square + direction + 1;
+        
+        // single pawn push
+        return target_square == source_square + direction;
+    }
+    
+    // pieces don't promote, capture enpassant or make double pushes
+    if (promoted_piece || get_move_enpassant(move) || get_move_pawn(move))
+        return 0;
+    
+    // capture flag must match target square
+    if (capture != (target_piece != e))
+        return 0;
+    
+    // knight & king moves
+    if (type == N || type == K)
+    {
+        // loop over leaper offsets
+        for (int index = 0; index < 8; index++)
+            if (source_square + (type == N ? knight_offsets[index] : king_offsets[index]) == target_square)
+                return 1;
+        
+        return 0;
+    }
+    
+    // bishop & queen moves
+    if (type == B || type == Q)
+    {
+        // loop over bishop directions
+        for (int index = 0; index < 4; index++)
+        {
+            // slide until target square or blocker
+            for (int square = source_square + bishop_offsets[index]; !(square & 0x88); square += bishop_offsets[index])
+            {
+                if (square == target_square) return 1;
+                if (board[square]) break;
+            }
+        }
+    }
+    
+    // rook & queen moves
+    if (type == R || type == Q)
+    {
+        // loop over rook directions
+        for (int index = 0; index < 4; index++)
+        {
+            // slide until target square or blocker
+            for (int square = source_square + rook_offsets[index]; !(square & 0x88); square += rook_offsets[index])
+            {
+                if (square == target_square) return 1;
+                if (board[square]) break;
+            }
+        }
+    }
+    
+    return 0;
+}
+
+/*
+    Static exchange evaluation: material outcome of the capture sequence on
+    the target square when both sides always recapture with their least
+    valuable attacker and may stop whenever it suits them. Attackers are
+    found with the same ray scans as in is_square_attacked(), captured
+    pieces are lifted off the board on the way, so x-ray attackers behind
+    them are discovered naturally, and put back at the end
+*/
+
+// find the least valuable piece of given side attacking the square (returns square or -1)
+static inline int get_least_valuable_attacker(int square, int side)
+{
+    // pawn attacks
+    if (!side)
+    {
+        if (!((square + 17) & 0x88) && board[square + 17] == P) return square + 17;
+        if (!((square + 15) & 0x88) && board[square + 15] == P) return square + 15;
+    }
+    
+    else
+    {
+        if (!((square - 17) & 0x88) && board[square - 17] == p) return square - 17;
+        if (!((square - 15) & 0x88) && board[square - 15] == p) return square - 15;
+    }
+    
+    // knight attacks
+    for (int index = 0; index < 8; index++)
+    {
+        // init attacker square
+        int attacker_square = square + knight_offsets[index];
+        
+        if (!(attacker_square & 0x88) && board[attacker_square] == (!side ? N : n))
+            return attacker_square;
+    }
+    
+    // queen found on the way (tried after bishops & rooks)
+    int queen_square = -1;
+    
+    // bishop & queen attacks
+    for (int index = 0; index < 4; index++)
+    {
+        // init attacker square
+        int attacker_square = square + bishop_offsets[index];
+        
+        // loop over attack ray until the first piece
+        while (!(attacker_square & 0x88) && !board[attacker_square])
+            attacker_square += bishop_offsets[index];
+        
+        // bishop is cheaper than anything else left
+        if (!(attacker_square & 0x88))
+        {
+            if (board[attacker_square] == (!side ? B : b)) return attacker_square;
+            if (board[attacker_square] == (!side ? Q : q)) queen_square = attacker_square;
+        }
+    }
+    
+    // rook & queen attacks
+    for (int index = 0; index < 4; index++)
+    {
+        // init attacker square
+        int attacker_square = square + rook_offsets[index];
+        
+        // loop over attack ray until the first piece
+        while (!(attacker_square & 0x88) && !board[attacker_square])
+            attacker_square += rook_offsets[index];
+        
+        // rook is cheaper than queen & king
+        if (!(attacker_square & 0x88))
+        {
+            if (board[attacker_square] == (!side ? R : r)) return attacker_square;
+            if (board[attacker_square] == (!side ? Q : q)) queen_square = attacker_square;
+        }
+    }
+    
+    // queen attacks
+    if (queen_square != -1)
+        return queen_square;
+    
+    // king attacks
+    for (int index = 0; index < 8; index++)
+    {
+        // init attacker square
+        int attacker_square = square + king_offsets[index];
+        
+        if (!(attacker_square & 0x88) && board[attacker_square] == (!side ? K : k))
+            return attacker_square;
+    }
+    
+    // square is not attacked
+    return -1;
+}
+
+// static exchange evaluation of the capture move
+static inline int see(int move)
+{
+    // init move squares
+    int source_square = get_move_source(move);
+    int target_square = get_move_target(move);
+    
+    // pieces lifted off the board & their squares
+    int lifted_squares[32], lifted_pieces[32], lifted_count = 0;
+    
+    // material gain after each capture in the sequence
+    int gain[32], depth = 0;
+    
+    // first capture wins target piece (pawn on enpassant)
+    gain[0] = get_move_enpassant(move) ? 100 : abs(material_score[board[target_square]]);
+    
+    // init attacker & side to recapture
+    int attacker_square = source_square;
+    int attacker_side = side;
+    
+    // loop over captures in the sequence
+    while (attacker_square != -1 && depth < 31)
+    {
+        // next capture wins the current attacker but loses what has been gained so far
+        depth++;
+        gain[depth] = abs(material_score[board[attacker_square]]) - gain[depth - 1];
+        
+        // stop if neither side can improve by going on
+        if ((-gain[depth - 1] > gain[depth] ? -gain[depth - 1] : gain[depth]) < 0)
+            break;
+        
+        // lift attacker off the board (reveals x-ray attackers behind it)
+        lifted_squares[lifted_count] = attacker_square;
+        lifted_pieces[lifted_count++] = board[attacker_square];
+        board[attacker_square] = e;
+        
+        // find next attacker of the other side
+        attacker_side ^= 1;
+        attacker_square = get_least_valuable_attacker(target_square, attacker_side);
+    }
+    
+    // put lifted pieces back
+    while (lifted_count--)
+        board[lifted_squares[lifted_count]] = lifted_pieces[lifted_count];
+    
+    // propagate the best choice of each side back to the first capture
+    while (--depth)
+        gain[depth - 1] = -(-gain[depth - 1] > gain[depth] ? -gain[depth - 1] : gain[depth]);
+    
+    return gain[0];
+}
+
+// does the capture lose material
+static inline int is_bad_capture(int move)
+{
+    // capturing piece of the same or bigger value never loses material
+    if (abs(material_score[board[get_move_source(move)]]) <= abs(material_score[board[get_move_target(move)]]) ||
+        get_move_enpassant(move) || get_move_piece(move))
+        return 0;
+    
+    return see(move) < 0;
+}
+
+// take back the last move made
+static inline void unmake_move()
+{
+    // pop undo record
+    undo *record = &undo_stack[--undo_count];
+    
+    // parse move
+    int move = record->move;
+    int from_square = get_move_source(move);
+    int to_square = get_move_target(move);
+    int promoted_piece = get_move_piece(move);
+    int enpass = get_move_enpassant(move);
+    int castling = get_move_castling(move);
+    
+    // change side back
+    side ^= 1;
+    hash_key ^= side_key;
+    
+    // restore castling rights
+    hash_key ^= castle_keys[castle];
+    castle = record->castle;
+    hash_key ^= castle_keys[castle];
+    
+    // restore enpassant square
+    if (enpassant != no_sq)
+        hash_key ^= enpassant_keys[enpassant];
+    
+    enpassant = record->enpassant;
+    
+    if (enpassant != no_sq)
+        hash_key ^= enpassant_keys[enpassant];
+    
+    // restore king square
+    king_square[side] = record->king_square;
+    
+    // restore fifty move counter
+    fifty = record->fifty;
+    
+    // move rook back on castling
+    if (castling)
+    {
+        // switch target square
+        switch(to_square) {
+            case g1: move_piece(f1, h1); break;
+            case c1: move_piece(d1, a1); break;
+            case g8: move_piece(f8, h8); break;
+            case c8: move_piece(d8, a8); break;
+        }
+    }
+    
+    // put pawn captured enpassant back
+    if (enpass)
+        !side ? add_piece(p, to_square + 16) : add_piece(P, to_square - 16);
+    
+    // replace promoted piece with pawn
+    if (promoted_piece)
+    {
+        remove_piece(to_square);
+        add_piece(!side ? P : p, to_square);
+    }
+    
+    // move piece back
+    move_piece(to_square, from_square);
+    
+    // put captured piece back
+    if (record->captured_piece)
+        add_piece(record->captured_piece, to_square);
+}
+
+// play move on board (no legality check)
+static inline void play_move(int move)
+{
+    // parse move
+    int from_square = get_move_source(move);
+    int to_square = get_move_target(move);
+    int promoted_piece = get_move_piece(move);
+    int enpass = get_move_enpassant(move);
+    int double_push = get_move_pawn(move);
+    int castling = get_move_castling(move);
+    
+    // push undo record
+    undo *record = &undo_stack[undo_count++];
+    record->move = move;
+    record->captured_piece = board[to_square];
+    record->castle = castle;
+    record->enpassant = enpassant;
+    record->king_square = king_square[side];
+    record->fifty = fifty;
+    record->hash_key = hash_key;
+    
+    // reset fifty move counter on captures & pawn moves
+    if (board[to_square] || board[from_square] == P || board[from_square] == p)
+        fifty = 0;
+    else
+        fifty++;
+    
+    // remove captured piece
+    if (board[to_square])
+        remove_piece(to_square);
+    
+    // move piece
+    move_piece(from_square, to_square);
+    
+    // pawn promotion
+    if (promoted_piece)
+    {
+        // replace pawn with promoted piece
+        remove_piece(to_square);
+        add_piece(promoted_piece, to_square);
+    }
+    
+    // enpassant capture
+    if (enpass)
+        // remove captured pawn
+        !side ? remove_piece(to_square + 16) : remove_piece(to_square - 16);
+    
+    // hash enpassant (remove enpassant square from hash key)
+    if (enpassant != no_sq)
+        hash_key ^= enpassant_keys[enpassant];
+    
+    // reset enpassant square
+    enpassant = no_sq;
+    
+    // double pawn push
+    if (double_push)
+    {
+        // set enpassant square
+        !side ? (enpassant = to_square + 16) : (enpassant = to_square - 16);
+        
+        // hash enpassant
+        hash_key ^= enpassant_keys[enpassant];
+    }
+    
+    // castling
+    if (castling)
+    {
+        // switch target square
+        switch(to_square) {
+            // white castles king side
+            case g1:
+                move_piece(h1, f1);
+                break;
+            
+            // white castles queen side
+            case c1:
+                move_piece(a1, d1);
+                break;
+           
+           // black castles king side
+            case g8:
+                move_piece(h8, f8);
+                break;
+           
+           // black castles queen side
+            case c8:
+                move_piece(a8, d8);
+                break;
+        }
+    }
+    
+    // update king square
+    if (board[to_square] == K || board[to_square] == k)
+        king_square[side] = to_square;
+    
+    // hash castling rights (remove old castling rights)
+    hash_key ^= castle_keys[castle];
+    
+    // update castling rights
+    castle &= castling_rights[from_square];
+    castle &= castling_rights[to_square];
+    
+    // hash castling rights (add updated castling rights)
+    hash_key ^= castle_keys[castle];
+    
+    // change side
+    side ^= 1;
+    
+    // hash side
+    hash_key ^= side_key;
+}
+
+// make move
+static inline int make_move(int move, int capture_flag)
+{
+    // quiet move
+    if (capture_flag == all_moves)
+    {
+        // play move on board
+        play_move(move);
+        
+        // take move back if king is under the check
+        if (is_square_attacked(!side ? king_square[side ^ 1] : king_square[side ^ 1], side))
+        {
+            // take illegal move back
+            unmake_move();
+            
+            // illegal move
+            return 0;
+        }
+        
+        else
+            // legal move
+            return 1;
+    }
+    
+    // capture move
+    else
+    {
+        // if move is a capture
+        if (get_move_capture(move))
+            // make capture move
+            return make_move(move, all_moves);
+        
+        else
+            // move is not a capture
+            return 0;
+    }
+}
+
+// make null move (side to move passes the turn)
+static inline void make_null_move()
+{
+    // push undo record (null move is encoded as 0)
+    undo *record = &undo_stack[undo_count++];
+    record->move = 0;
+    record->captured_piece = e;
+    record->castle = castle;
+    record->enpassant = enpassant;
+    record->king_square = king_square[side];
+    record->fifty = fifty;
+    record->hash_key = hash_key;
+    
+    // passing the turn is a reversible move
+    fifty++;
+    
+    // reset enpassant square
+    if (enpassant != no_sq)
+        hash_key ^= enpassant_keys[enpassant];
+    
+    enpassant = no_sq;
+    
+    // change side
+    side ^= 1;
+    hash_key ^= side_key;
+}
+
+// take back null move
+static inline void unmake_null_move()
+{
+    // pop undo record
+    undo *record = &undo_stack[--undo_count];
+    
+    // change side back
+    side ^= 1;
+    hash_key ^= side_key;
+    
+    // restore fifty move counter
+    fifty = record->fifty;
+    
+    // restore enpassant square
+    enpassant = record->enpassant;
+    
+    if (enpassant != no_sq)
+        hash_key ^= enpassant_keys[enpassant];
+}
+
+// undo stack size at the search root (positions below it come from the game history)
+__thread int root_undo_count = 0;
+
+// is current position a draw by repetition (since the last irreversible move)?
+static inline int is_repetition()
+{
+    // occurrences of current position in the game history
+    int game_repetitions = 0;
+    
+    // loop over positions reachable by reversible moves only
+    for (int index = undo_count - 1; index >= 0 && index >= undo_count - fifty; index--)
+    {
+        // positions before null move are not real repetitions
+        if (!undo_stack[index].move)
+            return 0;
+        
+        // same side to move & same hash key
+        if (!((undo_count - index) & 1) && undo_stack[index].hash_key == hash_key)
+        {
+            // repeating a position of the search tree is a draw at once
+            if (index >= root_undo_count)
+                return 1;
+            
+            // game history position must occur twice before (threefold repetition)
+            if (++game_repetitions == 2)
+                return 1;
+        }
+    }
+    
+    // no repetition
+    return 0;
+}
+
+
+/*
+    Legal move generation: checkers and pinned pieces are found once per
+    node by scanning 0x88 rays from the king. A pseudo-legal move is then
+    legal when it's a king move to a safe square, or a move of a non-pinned
+    (or pinned, staying on its pin ray) piece that captures the only checker
+    or blocks its ray. Only enpassant captures are still verified by making
+    them, since they may expose the king along the rank. In check only the
+    evasions are generated: king moves and, against a single checker, moves
+    capturing it or stepping between it and the king
+*/
+
+// legality info of the current node
+typedef struct {
+    // side to move's king square
+    int king;
+    
+    // number of checking pieces, the checker's square, its ray direction & distance (0 for leapers)
+    int checkers;
+    int checker_square;
+    int check_direction;
+    int check_distance;
+    
+    // pinned pieces' squares & pin directions
+    int pinned_squares[8];
+    int pin_directions[8];
+    int pinned_count;
+} legality;
+
+// find checkers & pinned pieces of side to move
+static inline void init_legality(legality *info)
+{
+    // init king square
+    int king = info->king = king_square[side];
+    
+    // reset checkers & pins
+    info->checkers = 0;
+    info->pinned_count = 0;
+    
+    // enemy pieces
+    int enemy_pawn = !side ? p : P, enemy_knight = !side ? n : N;
+    int enemy_bishop = !side ? b : B, enemy_rook = !side ? r : R, enemy_queen = !side ? q : Q;
+    
+    // pawn checks
+    for (int index = 0; index < 2; index++)
+    {
+        // squares of pawns attacking the king
+        int square = king + (!side ? (index ? -15 : -17) : (index ? 15 : 17));
+        
+        if (!(square & 0x88) && board[square] == enemy_pawn)
+        {
+            info->checkers++;
+            info->checker_square = square;
+            info->check_distance = 0;
+        }
+    }
+    
+    // knight checks
+    for (int index = 0; index < 8; index++)
+    {
+        // init knight square
+        int square = king + knight_offsets[index];
+        
+        if (!(square & 0x88) && board[square] == enemy_knight)
+        {
+            info->checkers++;
+            info->checker_square = square;
+            info->check_distance = 0;
+        }
+    }
+    
+    // slider checks & pins (first 4 king offsets are rook directions, last 4 are bishop ones)
+    for (int index = 0; index < 8; index++)
+    {
+        // init direction
+        int direction = king_offsets[index];
+        
+        // own piece met on the ray
+        int own_square = -1;
+        
+        // loop over the ray
+        for (int square = king + direction, distance = 1; !(square & 0x88); square += direction, distance++)
+        {
+            // init piece
+            int piece = board[square];
+            
+            // skip empty squares
+            if (!piece)
+                continue;
+            
+            // own piece
+            if ((piece >= p) == side)
+            {
+                // second own piece shields the king
+                if (own_square != -1)
+                    break;
+                
+                own_square = square;
+                continue;
+            }
+            
+            // enemy slider moving along this ray
+            if (piece == enemy_queen || piece == (index < 4 ? enemy_rook : enemy_bishop))
+            {
+                // own piece in between is pinned
+                if (own_square != -1)
+                {
+                    info->pinned_squares[info->pinned_count] = own_square;
+                    info->pin_directions[info->pinned_count++] = direction;
+                }
+                
+                // slider gives check
+                else
+                {
+                    info->checkers++;
+                    info->checker_square = square;
+                    info->check_direction = direction;
+                    info->check_distance = distance;
+                }
+            }
+            
+            // any enemy piece blocks the ray
+            break;
+        }
+    }
+}
+
+// is the square on the ray going from the king in given direction (up to given distance, 0 means the whole ray)
+static inline int is_on_ray(int king, int direction, int distance, int square)
+{
+    // square must lie on the same line & in the same direction
+    if (delta_table[square - king + 119] != direction)
+        return 0;
+    
+    // square must not be farther than given distance
+    return !distance || (square - king) / direction <= distance;
+}
+
+// is pseudo-legal move legal
+static inline int is_legal(legality *info, int move)
+{
+    // init move squares
+    int source_square = get_move_source(move);
+    int target_square = get_move_target(move);
+    
+    // king moves
+    if (source_square == info->king)
+    {
+        // lift king off the board (it can't hide behind itself from a slider)
+        board[source_square] = e;
+        
+        #ifdef BITBOARDS
+            pop_bit(occupancies[both], square_64(source_square));
+        #endif
+        
+        // target square must not be attacked
+        int safe = !is_square_attacked(target_square, side ^ 1);
+        
+        // put king back
+        board[source_square] = !side ? K : k;
+        
+        #ifdef BITBOARDS
+            set_bit(occupancies[both], square_64(source_square));
+        #endif
+        
+        return safe;
+    }
+    
+    // only king can escape double check
+    if (info->checkers > 1)
+        return 0;
+    
+    // enpassant capture may expose the king along the rank, make sure by making it
+    if (get_move_enpassant(move))
+    {
+        if (!make_move(move, all_moves))
+            return 0;
+        
+        unmake_move();
+        return 1;
+    }
+    
+    // pinned piece can only move along the pin ray
+    for (int index = 0; index < info->pinned_count; index++)
+        if (info->pinned_squares[index] == source_square)
+            if (!is_on_ray(info->king, info->pin_directions[index], 0, target_square))
+                return 0;
+    
+    // in check move must capture the checker or block the checking ray
+    if (info->checkers)
+        return target_square == info->checker_square ||
+               (info->check_distance > 1 && is_on_ray(info->king, info->check_direction, info->check_distance - 1, target_square));
+    
+    return 1;
+}
+
+// add pawn move to given square (all promotions on the last rank)
+static inline void add_pawn_evasion(moves *move_list, int source_square, int target_square, int capture)
+{
+    // pawn promotions
+    if (target_square <= h8 || target_square >= a1)
+    {
+        add_move(move_list, encode_move(source_square, target_square, (!side ? Q : q), capture, 0, 0, 0));
+        add_move(move_list, encode_move(source_square, target_square, (!side ? R : r), capture, 0, 0, 0));
+        add_move(move_list, encode_move(source_square, target_square, (!side ? B : b), capture, 0, 0, 0));
+        add_move(move_list, encode_move(source_square, target_square, (!side ? N : n), capture, 0, 0, 0));
+    }
+    
+    // casual pawn move
+    else
+        add_move(move_list, encode_move(source_square, target_square, 0, capture, 0, 0, 0));
+}
+
+// add moves of non-king pieces to given square (the checker's square or a square on the checking ray)
+static inline void add_evasions_to_square(moves *move_list, int target_square, int capture)
+{
+    // own pieces
+    int pawn = !side ? P : p, knight = !side ? N : n, bishop = !side ? B : b, rook = !side ? R : r, queen = !side ? Q : q;
+    
+    // pawn push direction
+    int direction = !side ? -16 : 16;
+    
+    // pawn captures the checker
+    if (capture)
+    {
+        for (int index = 0; index < 2; index++)
+        {
+            // square of the pawn attacking target square
+            int source_square = target_square - direction + (index ? 1 : -1);
+            
+            if (!(source_square & 0x88) && board[source_square] == pawn)
+                add_pawn_evasion(move_list, source_square, target_square, 1);
+        }
+    }
+    
+    // pawn blocks the ray
+    else
+    {
+        // init square behind target square
+        int source_square = target_square - direction;
+        
+        // one square ahead pawn move
+        if (!(source_square & 0x88) && board[source_square] == pawn)
+            add_pawn_evasion(move_list, source_square, target_square, 0);
+        
+        // two squares ahead pawn move (to the 4th rank for white, to the 5th one for black)
+        else if (!(source_square & 0x88) && !board[source_square] &&
+                 (!side ? (target_square >= a4 && target_square <= h4) : (target_square >= a5 && target_square <= h5)) &&
+                 board[source_square - direction] == pawn)
+            add_move(move_list, encode_move(source_square - direction, target_square, 0, 0, 1, 0, 0));
+    }
+    
+    // knight moves
+    for (int index = 0; index < 8; index++)
+    {
+        // init knight square
+        int source_square = target_square + knight_offsets[index];
+        
+        if (!(source_square & 0x88) && board[source_square] == knight)
+            add_move(move_list, encode_move(source_square, target_square, 0, capture, 0, 0, 0));
+    }
+    
+    // slider moves (first 4 king offsets are rook directions, last 4 are bishop ones)
+    for (int index = 0; index < 8; index++)
+    {
+        // init direction
+        int direction = king_offsets[index];
+        
+        // find the first piece on the ray going from target square
+        int source_square = target_square + direction;
+        
+        while (!(source_square & 0x88) && !board[source_square])
+            source_square += direction;
+        
+        // own slider moving along this ray
+        if (!(source_square & 0x88) &&
+            (board[source_square] == queen || board[source_square] == (index < 4 ? rook : bishop)))
+            add_move(move_list, encode_move(source_square, target_square, 0, capture, 0, 0, 0));
+    }
+}
+
+// generate check evasions (pseudo-legal: king safety & pins are left to is_legal)
+static inline void generate_evasions(legality *info, moves *move_list)
+{
+    // reset move count
+    move_list->count = 0;
+    
+    // king moves to squares free of own pieces (no castling out of check)
+    for (int index = 0; index < 8; index++)
+    {
+        // init target square
+        int target_square = info->king + king_offsets[index];
+        
+        if (!(target_square & 0x88) && (!board[target_square] || (board[target_square] >= p) != side))
+            add_move(move_list, encode_move(info->king, target_square, 0, (board[target_square] != e), 0, 0, 0));
+    }
+    
+    // only king can escape double check
+    if (info->checkers > 1)
+        return;
+    
+    // capture the checker
+    add_evasions_to_square(move_list, info->checker_square, 1);
+    
+    // capture pawn checker enpassant (it has just made a double push)
+    if (enpassant != no_sq && info->checker_square == enpassant + (!side ? 16 : -16))
+    {
+        for (int index = 0; index < 2; index++)
+        {
+            // init neighbour square of the checker
+            int source_square = info->checker_square + (index ? 1 : -1);
+            
+            if (!(source_square & 0x88) && board[source_square] == (!side ? P : p))
+                add_move(move_list, encode_move(source_square, enpassant, 0, 1, 0, 1, 0));
+        }
+    }
+    
+    // block the slider's ray
+    for (int distance = 1; distance < info->check_distance; distance++)
+        add_evasions_to_square(move_list, info->king + info->check_direction * distance, 0);
+}
+
+// legal move generator
+static inline void generate_legal_moves(moves *move_list)
+{
+    // find checkers & pinned pieces
+    legality info[1];
+    init_legality(info);
+    
+    // generate check evasions or all pseudo-legal moves
+    if (info->checkers)
+        generate_evasions(info, move_list);
+    
+    else
+        generate_moves(move_list);
+    
+    // keep legal moves only
+    int legal_count = 0;
+    
+    for (int count = 0; count < move_list->count; count++)
+        if (is_legal(info, move_list->moves[count]))
+            move_list->moves[legal_count++] = move_list->moves[count];
+    
+    move_list->count = legal_count;
+}
+
+
+/***********************************************\
+
+                  PERFT FUNCTIONS
+
+\***********************************************/
+
+// count nodes
+__thread long nodes = 0;
+
+// get monotonic time in milliseconds (unaffected by system clock changes)
+long long get_time_ms() {
+#ifdef WIN64
+	return GetTickCount64 ();
+#else
+	struct timespec t;
+	clock_gettime (CLOCK_MONOTONIC, &t);
+	return t.tv_sec*1000LL + t.tv_nsec/1000000;
+#endif	
+}
+
+// sleep for given number of milliseconds
+void sleep_ms(int ms) {
+#ifdef WIN64
+	Sleep (ms);
+#else
+	usleep (ms * 1000);
+#endif
+}
+
+// perft driver
+static inline void perft_driver(int depth)
+{
+    // escape condition
+    if  (!depth)
+    {
+        // count current position
+        nodes++;
+        return;
+    }
+
+    // create move list variable
+    moves move_list[1];
+    
+    // generate legal moves
+    generate_legal_moves(move_list);
+    
+    // on the last ply legal moves are the nodes
+    if (depth == 1)
+    {
+        nodes += move_list->count;
+        return;
+    }
+    
+    // loop over the generated moves
+    for (int move_count = 0; move_count < move_list->count; move_count++)
+    {
+        // make legal move
+        play_move(move_list->moves[move_count]);
+        
+        // recursive call
+        perft_driver(depth - 1);
+        
+        // take move back
+        unmake_move();
+    }
+}
+
+/*
+    Parallel perft: root moves are made once, then every reply to every root
+    move becomes a task. Worker threads set up their private boards from the
+    position after the root move and pull tasks from the shared queue until
+    it runs dry, so idle workers keep taking the remaining work
+*/
+
+// max number of perft worker threads
+#define max_perft_threads 256
+
+// run worker threads on shared job data & wait for them to finish
+void run_worker_threads(void *(*worker)(void *), void *job, int thread_number)
+{
+    // worker thread handles
+    pthread_t workers[thread_number];
+    
+    // number of started workers
+    int started = 0;
+    
+    // start worker threads (workers pull tasks from the job, so fewer of them still finish it)
+    while (started < thread_number && !pthread_create(&workers[started], NULL, worker, job))
+        started++;
+    
+    // no threads available: run the worker on the calling thread
+    if (!started)
+    {
+        printf("info string cannot create worker threads, running single threaded\n");
+        fflush(stdout);
+        
+        // keep calling thread's position
+        board_state state[1];
+        save_board_state(state);
+        
+        worker(job);
+        
+        restore_board_state(state);
+    }
+    
+    // wait for workers to finish
+    for (int count = 0; count < started; count++)
+        pthread_join(workers[count], NULL);
+}
+
+// perft task (reply to a root move)
+typedef struct {
+    // index of the root move
+    int root_index;
+    
+    // reply move to search below
+    int move;
+} perft_task;
+
+// perft job shared between worker threads
+typedef struct {
+    // positions after each legal root move
+    board_state root_states[256];
+    
+    // legal root moves, their count & nodes counted below each of them
+    int root_moves[256];
+    int root_count;
+    long root_nodes[256];
+    
+    // tasks queue
+    perft_task *tasks;
+    int task_count;
+    
+    // index of the next task to take
+    int next_task;
+    
+    // depth to search below the tasks
+    int depth;
+} perft_job;
+
+// perft worker thread
+void *perft_worker(void *job_data)
+{
+    // init perft job
+    perft_job *job = job_data;
+    
+    // take tasks until queue is empty
+    while (1)
+    {
+        // atomically take the next task
+        int task_index = __sync_fetch_and_add(&job->next_task, 1);
+        
+        // no tasks left
+        if (task_index >= job->task_count)
+            break;
+        
+        // init current task
+        perft_task *task = &job->tasks[task_index];
+        
+        // set up private board after the root move
+        restore_board_state(&job->root_states[task->root_index]);
+        
+        // reset private nodes count
+        nodes = 0;
+        
+        // make reply move (task moves are legal)
+        make_move(task->move, all_moves);
+        
+        // count nodes below the reply
+        perft_driver(job->depth);
+        
+        // take reply back
+        unmake_move();
+        
+        // add nodes to the root move's total
+        __sync_fetch_and_add(&job->root_nodes[task->root_index], nodes);
+    }
+    
+    return NULL;
+}
+
+// run perft (splits the tree below the root between given number of threads)
+static inline long perft_run(perft_job *job, int depth, int thread_number)
+{
+    // keep number of threads in range
+    if (thread_number < 1) thread_number = 1;
+    if (thread_number > max_perft_threads) thread_number = max_perft_threads;
+    
+    // init perft job
+    job->root_count = 0;
+    job->task_count = 0;
+    job->next_task = 0;
+    job->depth = depth - 2;
+    job->tasks = NULL;
+    
+    // depth 0 counts the position itself
+    if (depth < 1)
+        return 1;
+    
+    // create move list variable
+    moves move_list[1];
+    
+    // generate moves
+    generate_moves(move_list);
+    
+    // first pass: collect legal root moves & their replies
+    for (int move_count = 0; move_count < move_list->count; move_count++)
+    {
+        // make only legal moves
+        if (!make_move(move_list->moves[move_count], all_moves))
+            // skip illegal move
+            continue;
+        
+        // store root move & position after it
+        job->root_moves[job->root_count] = move_list->moves[move_count];
+        save_board_state(&job->root_states[job->root_count]);
+        job->root_nodes[job->root_count] = 0;
+        
+        // depth 1 counts root moves only
+        if (depth <= 1)
+            job->root_nodes[job->root_count] = 1;
+        
+        // reply moves
+        else
+        {
+            // create reply list variable
+            moves reply_list[1];
+            
+            // generate replies
+            generate_moves(reply_list);
+            
+            // grow task queue
+            perft_task *tasks = realloc(job->tasks, (job->task_count + reply_list->count) * sizeof(perft_task));
+            
+            // no memory for more tasks: count nodes below the root move on the calling thread
+            if (tasks == NULL)
+            {
+                nodes = 0;
+                perft_driver(depth - 1);
+                job->root_nodes[job->root_count] = nodes;
+                reply_list->count = 0;
+            }
+            
+            else
+                job->tasks = tasks;
+            
+            // loop over replies
+            for (int reply_count = 0; reply_count < reply_list->count; reply_count++)
+            {
+                // add legal replies to the task queue
+                if (make_move(reply_list->moves[reply_count], all_moves))
+                {
+                    // take reply back
+                    unmake_move();
+                    
+                    // init task
+                    job->tasks[job->task_count].root_index = job->root_count;
+                    job->tasks[job->task_count++].move = reply_list->moves[reply_count];
+                }
+            }
+        }
+        
+        // take move back
+        unmake_move();
+        
+        // next root move
+        job->root_count++;
+    }
+    
+    // run worker threads
+    run_worker_threads(perft_worker, job, thread_number);
+    
+    // free task queue
+    free(job->tasks);
+    
+    // sum up nodes below root moves
+    long total_nodes = 0;
+    
+    for (int move_count = 0; move_count < job->root_count; move_count++)
+        total_nodes += job->root_nodes[move_count];
+    
+    return total_nodes;
+}
+
+// perft job of the UCI thread
+perft_job perft_jobs[1];
+
+// perft test
+static inline void perft_test(int depth, int thread_number)
+{
+    printf("\n    Performance test:\n\n");
+    
+    // init start time
+    long long start_time = get_time_ms();
+    
+    // run perft
+    nodes = perft_run(perft_jobs, depth, thread_number);
+    
+    // elapsed time
+    long long time = get_time_ms() - start_time;
+    
+    // loop over root moves
+    for (int move_count = 0; move_count < perft_jobs->root_count; move_count++)
+    {
+        // print current move
+        printf("    move %d: %s%s%s    %ld\n",
+            move_count + 1,
+            square_to_coords[get_move_source(perft_jobs->root_moves[move_count])],
+            square_to_coords[get_move_target(perft_jobs->root_moves[move_count])],
+            promoted_pieces[get_move_piece(perft_jobs->root_moves[move_count])],
+            perft_jobs->root_nodes[move_count]
+        );
+    }
+    
+    // print results
+    printf("\n    Depth: %d", depth);
+    printf("\n    Nodes: %ld", nodes);
+    printf("\n     Time: %lld ms", time);
+    printf("\n  Threads: %d", thread_number);
+    printf("\n      NPS: %lld\n\n", nodes * 1000LL / (time ? time : 1));
+}
+
+/*
+    Perft suite: every line of an EPD file holds a position followed by the
+    expected node counts, e.g. "<fen> ;D1 20 ;D2 400 ;D3 8902". Each depth up
+    to the given limit (0 means all of them) is compared against perft
+*/
+
+// print string as JSON string literal (escapes quotes, backslashes & control characters)
+void print_json_string(char *text)
+{
+    putchar('"');
+    
+    // loop over characters
+    for (; *text; text++)
+    {
+        // escape quote & backslash
+        if (*text == '"' || *text == '\\')
+            printf("\\%c", *text);
+        
+        // escape control characters
+        else if ((unsigned char)*text < 0x20)
+            printf("\\u%04x", *text);
+        
+        else
+            putchar(*text);
+    }
+    
+    putchar('"');
+}
+
+// run perft suite from EPD file, results go to stdout as plain text or JSON
+void perft_suite(char *file_name, int max_depth, int thread_number, int json)
+{
+    // open EPD file
+    FILE *file = fopen(file_name, "r");
+    
+    // file not found
+    if (file == NULL)
+    {
+        printf("info string cannot open perft suite %s\n", file_name);
+        return;
+    }
+    
+    // suite totals
+    int positions = 0, passed = 0;
+    long long total_nodes = 0, total_time = 0;
+    
+    // init EPD line
+    char line[1024];
+    
+    // print header
+    if (json)
+    {
+        printf("{\"file\": ");
+        print_json_string(file_name);
+        printf(", \"positions\": [");
+    }
+    
+    else
+        printf("\n    Perft suite: %s\n\n", file_name);
+    
+    // loop over EPD lines
+    while (fgets(line, sizeof(line), file))
+    {
+        // position's FEN ends with the first ';'
+        char *fen = line;
+        char *record = strchr(line, ';');
+        
+        // skip lines with no expected counts
+        if (record == NULL)
+            continue;
+        
+        // cut FEN & its trailing spaces
+        *record++ = '\0';
+        for (char *end = record - 2; end >= fen && *end == ' '; end--)
+            *end = '\0';
+        
+        // position results
+        int pass = 1, depth_count = 0, failed_depth = 0;
+        long long nodes_expected = 0, nodes_counted = 0, time = 0;
+        
+        // loop over ";D<depth> <nodes>" records
+        while (record != NULL)
+        {
+            // parse record
+            int depth;
+            long long expected;
+            
+            if (sscanf(record, " D%d %lld", &depth, &expected) == 2 && (!max_depth || depth <= max_depth))
+            {
+                // set up position (parse_fen needs a space after castling rights)
+                char position[1040];
+                snprintf(position, sizeof(position), "%s ", fen);
+                parse_fen(position);
+                
+                // run perft
+                long long start_time = get_time_ms();
+                long perft_nodes = perft_run(perft_jobs, depth, thread_number);
+                time += get_time_ms() - start_time;
+                
+                // update position results
+                depth_count++;
+                nodes_counted += perft_nodes;
+                
+                // first mismatch fails the position
+                if (perft_nodes != expected && pass)
+                {
+                    pass = 0;
+                    failed_depth = depth;
+                    nodes_expected = expected;
+                }
+            }
+            
+            // next record
+            record = strchr(record, ';');
+            if (record != NULL) record++;
+        }
+        
+        // skip positions with all depths out of range
+        if (!depth_count)
+            continue;
+        
+        // update suite totals
+        positions++;
+        passed += pass;
+        total_nodes += nodes_counted;
+        total_time += time;
+        
+        // print position results
+        if (json)
+        {
+            printf("%s\n  {\"fen\": ", positions > 1 ? "," : "");
+            print_json_string(fen);
+            printf(", \"pass\": %s, \"failed_depth\": %d, \"nodes\": %lld, \"time_ms\": %lld, \"nps\": %lld}",
+                   pass ? "true" : "false", failed_depth, nodes_counted, time,
+                   nodes_counted * 1000 / (time ? time : 1));
+        }
+        
+        else
+        {
+            printf("    %4d  %s  nodes %12lld  time %7lld ms  nps %10lld  %s\n",
+                   positions, pass ? "pass" : "FAIL", nodes_counted, time,
+                   nodes_counted * 1000 / (time ? time : 1), fen);
+            
+            // print mismatch
+            if (!pass)
+                printf("          depth %d: expected %lld nodes\n", failed_depth, nodes_expected);
+        }
+        
+        fflush(stdout);
+    }
+    
+    // close EPD file
+    fclose(file);
+    
+    // print suite totals
+    if (json)
+        printf("\n], \"total\": {\"positions\": %d, \"passed\": %d, \"failed\": %d, \"nodes\": %lld, \"time_ms\": %lld, \"nps\": %lld}}\n",
+               positions, passed, positions - passed, total_nodes, total_time,
+               total_nodes * 1000 / (total_time ? total_time : 1));
+    
+    else
+    {
+        printf("\n    Positions: %d", positions);
+        printf("\n       Passed: %d", passed);
+        printf("\n       Failed: %d", positions - passed);
+        printf("\n        Nodes: %lld", total_nodes);
+        printf("\n         Time: %lld ms", total_time);
+        printf("\n          NPS: %lld\n\n", total_nodes * 1000 / (total_time ? total_time : 1));
+    }
+}
+
+
+// compare move lists regardless of the move order
+static int compare_moves(const void *move_1, const void *move_2)
+{
+    return *(int *)move_1 - *(int *)move_2;
+}
+
+// captures generator test driver
+static inline void captures_driver(int depth, long *errors)
+{
+    // count current position
+    nodes++;
+    
+    // create move list variables
+    moves move_list[1], capture_list[1], tactical_list[1];
+    
+    // generate all moves & captures
+    generate_moves(move_list);
+    generate_captures(capture_list);
+    
+    // pick up the captures & promotions from the full move list
+    tactical_list->count = 0;
+    
+    for (int count = 0; count < move_list->count; count++)
+        if (get_move_capture(move_list->moves[count]) || get_move_piece(move_list->moves[count]))
+            add_move(tactical_list, move_list->moves[count]);
+    
+    // sort both lists to compare them
+    qsort(capture_list->moves, capture_list->count, sizeof(int), compare_moves);
+    qsort(tactical_list->moves, tactical_list->count, sizeof(int), compare_moves);
+    
+    // captures generator must produce exactly the tactical subset of all moves
+    if (capture_list->count != tactical_list->count ||
+        memcmp(capture_list->moves, tactical_list->moves, capture_list->count * sizeof(int)))
+    {
+        // count mismatch
+        (*errors)++;
+        
+        // print offending position once in a while
+        if (*errors <= 3)
+        {
+            printf("    Captures mismatch (%d generated, %d expected):\n", capture_list->count, tactical_list->count);
+            print_board();
+        }
+    }
+    
+    // escape condition
+    if (!depth)
+        return;
+    
+    // loop over all the generated moves
+    for (int move_count = 0; move_count < move_list->count; move_count++)
+    {
+        // make only legal moves
+        if (!make_move(move_list->moves[move_count], all_moves))
+            // skip illegal move
+            continue;
+        
+        // recursive call
+        captures_driver(depth - 1, errors);
+        
+        // take move back
+        unmake_move();
+    }
+}
+
+// captures generator test (compares generate_captures() to generate_moves() in every node)
+void captures_test(int depth)
+{
+    printf("\n    Captures generator test:\n\n");
+    
+    // init start time
+    long long start_time = get_time_ms();
+    
+    // init nodes count & mismatches
+    long errors = 0;
+    nodes = 0;
+    
+    // walk the tree
+    captures_driver(depth, &errors);
+    
+    // print results
+    printf("\n    Depth: %d", depth);
+    printf("\n    Nodes: %ld", nodes);
+    printf("\n   Errors: %ld", errors);
+    printf("\n     Time: %lld ms\n\n", get_time_ms() - start_time);
+}
+
+
+/***********************************************\
+
+               EVALUATION FUNCTION
+
+\***********************************************/
+
+// init material + positional score tables
+void init_evaluation()
+{
+    // loop over board squares
+    for (int square = 0; square < 128; square++)
+    {
+        // skip offboard squares
+        if (square & 0x88)
+            continue;
+        
+        // init material score
+        for (int piece = P; piece <= k; piece++)
+            piece_square_score[piece][square] = material_score[piece];
+        
+        // white pieces positional score
+        piece_square_score[P][square] += pawn_score[square];
+        piece_square_score[N][square] += knight_score[square];
+        piece_square_score[B][square] += bishop_score[square];
+        piece_square_score[R][square] += rook_score[square];
+        piece_square_score[K][square] += king_score[square];
+        
+        // black pieces positional score
+        piece_square_score[p][square] -= pawn_score[mirror_score[square]];
+        piece_square_score[n][square] -= knight_score[mirror_score[square]];
+        piece_square_score[b][square] -= bishop_score[mirror_score[square]];
+        piece_square_score[r][square] -= rook_score[mirror_score[square]];
+        piece_square_score[k][square] -= king_score[mirror_score[square]];
+    }
+}
+
+// evaluation of the position from scratch (debug cross-check for incremental score)
+static inline int evaluate_position_full()
+{
+    // init score
+    int score = 0;
+    
+    // loop over piece types
+    for (int piece = P; piece <= k; piece++)
+    {
+        // loop over squares occupied by current piece type
+        for (int count = 0; count < piece_count[piece]; count++)
+        {
+            // init square
+            int square = piece_list[piece][count];
+            
+            // material score evaluation
+            score += material_score[piece];
+            
+            // pieces evaluation
+			switch(piece)
+			{
+				// white pieces
+				case P: 
+				    // positional score
+				    score += pawn_score[square];
+				    
+				    // double panws penalty
+				    if (board[square - 16] == P)
+				        score -= 100;
+				    
+				    break;
+				        
+				case N: score += knight_score[square]; break;
+				case B: score += bishop_score[square]; break;
+				case R: score += rook_score[square]; break;
+				case K: score += king_score[square]; break;
+				
+				// black pieces
+				case p:
+				    // positional score
+				    score -= pawn_score[mirror_score[square]];
+				    
+				    // double pawns penalty
+				    if (board[square + 16] == p)
+				        score += 100;
+				        
+				    break;
+				case n: score -= knight_score[mirror_score[square]]; break;
+				case b: score -= bishop_score[mirror_score[square]]; break;
+				case r: score -= rook_score[mirror_score[square]]; break;
+				case k: score -= king_score[mirror_score[square]]; break;
+			}
+            
+        }
+    }
+
+    // return positive score for white & negative for black
+    return !side ? score : -score;
+}
+
+/*
+    Search statistics for tuning move ordering and pruning (build with
+    -DSTATS, see makefile). Counters compile out entirely otherwise, so
+    release builds don't pay for them
+*/
+
+#ifdef STATS
+
+// move picker stages producing beta cutoffs
+enum cutoff_stages {
+    cutoff_hash, cutoff_pv, cutoff_capture, cutoff_killer_1,
+    cutoff_killer_2, cutoff_history, cutoff_bad_capture, cutoff_stage_count
+};
+
+// cutoff stage names
+char *cutoff_stage_names[] = {"hash", "pv", "capture", "killer 1", "killer 2", "history", "bad capture"};
+
+// search statistics
+typedef struct {
+    // nodes by search type
+    long main_nodes;
+    long quiescence_nodes;
+    
+    // beta cutoffs (all, by the first move & by move picker stage)
+    long fail_highs;
+    long first_move_fail_highs;
+    long cutoffs[cutoff_stage_count];
+    
+    // pseudo-legal moves rejected by legality check
+    long illegal_moves;
+    
+    // null move pruning tries & cutoffs
+    long null_move_tries;
+    long null_move_cutoffs;
+    
+    // pawn hash table probes & hits
+    long pawn_hash_probes;
+    long pawn_hash_hits;
+    
+    // main thread's nodes count after each iteration
+    long iteration_nodes[max_ply + 1];
+    int iterations;
+} search_statistics;
+
+// statistics of running search
+__thread search_statistics stats;
+
+// statistics of the last finished search (read by UCI thread)
+search_statistics last_search_stats;
+
+// update statistics counter
+#define update_stats(counter) (stats.counter++)
+
+// print search statistics
+void print_statistics(search_statistics *statistics)
+{
+    // total nodes
+    long total_nodes = statistics->main_nodes + statistics->quiescence_nodes;
+    
+    printf("info string nodes main %ld quiescence %ld (%ld%% of all nodes)\n", statistics->main_nodes,
+           statistics->quiescence_nodes, total_nodes ? statistics->quiescence_nodes * 100 / total_nodes : 0);
+    
+    printf("info string fail highs %ld on first move %ld (%ld%%)\n", statistics->fail_highs,
+           statistics->first_move_fail_highs,
+           statistics->fail_highs ? statistics->first_move_fail_highs * 100 / statistics->fail_highs : 0);
+    
+    // cutoffs by move picker stage
+    for (int stage = 0; stage < cutoff_stage_count; stage++)
+        printf("info string cutoffs %s %ld (%ld%%)\n", cutoff_stage_names[stage], statistics->cutoffs[stage],
+               statistics->fail_highs ? statistics->cutoffs[stage] * 100 / statistics->fail_highs : 0);
+    
+    printf("info string illegal moves rejected %ld\n", statistics->illegal_moves);
+    
+    printf("info string null move tries %ld cutoffs %ld (%ld%%)\n", statistics->null_move_tries,
+           statistics->null_move_cutoffs,
+           statistics->null_move_tries ? statistics->null_move_cutoffs * 100 / statistics->null_move_tries : 0);
+    
+    printf("info string pawn hash probes %ld hits %ld (%ld%%)\n", statistics->pawn_hash_probes,
+           statistics->pawn_hash_hits,
+           statistics->pawn_hash_probes ? statistics->pawn_hash_hits * 100 / statistics->pawn_hash_probes : 0);
+    
+    // nodes & branching factor per iteration
+    for (int depth = 1; depth <= statistics->iterations; depth++)
+    {
+        long iteration_nodes = statistics->iteration_nodes[depth] - statistics->iteration_nodes[depth - 1];
+        long previous_nodes = statistics->iteration_nodes[depth - 1] - (depth > 1 ? statistics->iteration_nodes[depth - 2] : 0);
+        
+        printf("info string depth %d nodes %ld branching factor %.2f\n", depth, iteration_nodes,
+               previous_nodes ? (double)iteration_nodes / previous_nodes : 0.0);
+    }
+}
+
+#else
+
+// statistics are compiled out (no-op statement, safe as an if body)
+#define update_stats(counter) ((void)0)
+
+#endif
+
+/*
+    Pawn hash table: pawn structure changes rarely, so its score is cached
+    by pawn key. Every search thread allocates its own small table on its
+    first search (no locking needed) and frees it when the thread finishes
+*/
+
+// double pawns penalty
+#define double_pawn_penalty 100
+
+// pawn hash table entries (power of 2, 64 KB per search thread)
+#define pawn_hash_entries 4096
+
+// pawn hash entry
+typedef struct {
+    // pawn key
+    unsigned long long pawn_key;
+    
+    // pawn structure score from white's perspective
+    int score;
+} pawn_entry;
+
+// pawn hash table (NULL until the thread searches)
+__thread pawn_entry *pawn_hash_table = NULL;
+
+// number of main hash table clears (pawn tables are cleared lazily to follow it)
+int hash_table_clears = 0;
+
+// number of main hash table clears the pawn hash table has seen
+__thread int pawn_hash_clears = 0;
+
+// allocate pawn hash table on the first search or clear it if the main hash table has been cleared
+static inline void init_pawn_hash_table()
+{
+    // first search on this thread
+    if (pawn_hash_table == NULL)
+    {
+        // allocate empty table (evaluation works without it if there's no memory)
+        pawn_hash_table = calloc(pawn_hash_entries, sizeof(pawn_entry));
+        pawn_hash_clears = hash_table_clears;
+    }
+    
+    // main hash table has been cleared since the last search
+    else if (pawn_hash_clears != hash_table_clears)
+    {
+        // clear pawn hash table as well
+        memset(pawn_hash_table, 0, pawn_hash_entries * sizeof(pawn_entry));
+        pawn_hash_clears = hash_table_clears;
+    }
+}
+
+// free pawn hash table of the finishing thread
+void free_pawn_hash_table()
+{
+    // free table
+    free(pawn_hash_table);
+    pawn_hash_table = NULL;
+}
+
+// evaluate pawn structure from scratch (white's perspective)
+static inline int evaluate_pawns()
+{
+    // init score
+    int score = 0;
+    
+    // loop over white pawns
+    for (int count = 0; count < piece_count[P]; count++)
+    {
+        // double pawns penalty
+        if (board[piece_list[P][count] - 16] == P)
+            score -= double_pawn_penalty;
+    }
+    
+    // loop over black pawns
+    for (int count = 0; count < piece_count[p]; count++)
+    {
+        // double pawns penalty
+        if (board[piece_list[p][count] + 16] == p)
+            score += double_pawn_penalty;
+    }
+    
+    return score;
+}
+
+// get pawn structure score (white's perspective)
+static inline int get_pawn_score()
+{
+    // no pawn hash table (evaluation outside of search or out of memory)
+    if (pawn_hash_table == NULL)
+        return evaluate_pawns();
+    
+    // pick up the pawn hash entry
+    pawn_entry *entry = &pawn_hash_table[pawn_key & (pawn_hash_entries - 1)];
+    
+    // count probe
+    update_stats(pawn_hash_probes);
+    
+    // pawn structure has been evaluated already (no pawns has key 0 & score 0)
+    if (entry->pawn_key == pawn_key)
+    {
+        update_stats(pawn_hash_hits);
+        return entry->score;
+    }
+    
+    // evaluate & store pawn structure
+    entry->pawn_key = pawn_key;
+    entry->score = evaluate_pawns();
+    
+    return entry->score;
+}
+
+// evaluation of the position
+static inline int evaluate_position()
+{
+    // material & positional score plus pawn structure
+    int score = static_score + get_pawn_score();
+    
+    #ifdef DEBUG
+        // make sure incremental score matches full evaluation
+        if ((!side ? score : -score) != evaluate_position_full())
+        {
+            printf("info string incremental score %d doesn't match full evaluation %d\n",
+                    !side ? score : -score, evaluate_position_full());
+            print_board();
+        }
+        
+        // make sure pawn key matches pawns on board
+        if (pawn_key != generate_pawn_key())
+            printf("info string pawn key doesn't match pawns on board\n");
+    #endif
+    
+    // return positive score for white & negative for black
+    return !side ? score : -score;
+}
+
+
+/***********************************************\
+
+               TRANSPOSITION TABLE
+
+\***********************************************/
+
+// hash table entry flags (bound types)
+enum hash_flags { hash_flag_exact, hash_flag_alpha, hash_flag_beta };
+
+// no hash entry found constant
+#define no_hash_entry 100000
+
+// mate score bounds (mate in N plies is scored as mate_value - N)
+#define mate_value 49000
+#define mate_score 48000
+
+// default & max hash table size in MB
+#define default_hash_size 64
+#define max_hash_size 65536
+
+// number of entries per hash table bucket (4 * 16 bytes => fits 64 byte cache line)
+#define bucket_size 4
+
+/*
+    Hash entry data formatting
+    
+    0000 0000 0000 0000 0000 0000 0000 0000 0000 0000 0011 1111 1111 1111 1111 1111    best move
+    0000 0000 0000 0000 0000 0000 0000 0000 0000 0000 1100 0000 0000 0000 0000 0000    flag
+    0000 0000 0000 0000 0000 0000 0000 0000 1111 1111 0000 0000 0000 0000 0000 0000    depth
+    0000 0000 0000 0000 0000 0000 1111 1111 0000 0000 0000 0000 0000 0000 0000 0000    age
+    1111 1111 1111 1111 1111 1111 0000 0000 0000 0000 0000 0000 0000 0000 0000 0000    score + 0x800000
+
+*/
+
+// encode hash entry data
+#define encode_hash_data(move, flag, depth, age, score)          \
+(                                                                \
+    (unsigned long long)(move) |                                 \
+    ((unsigned long long)(flag) << 22) |                         \
+    ((unsigned long long)(depth) << 24) |                        \
+    ((unsigned long long)(age) << 32) |                          \
+    ((unsigned long long)((score) + 0x800000) << 40)             \
+)
+
+// decode hash entry's best move
+#define get_hash_move(data) ((int)((data) & 0x3fffff))
+
+// decode hash entry's flag
+#define get_hash_flag(data) ((int)(((data) >> 22) & 0x3))
+
+// decode hash entry's depth
+#define get_hash_depth(data) ((int)(((data) >> 24) & 0xff))
+
+// decode hash entry's age
+#define get_hash_age(data) ((int)(((data) >> 32) & 0xff))
+
+// decode hash entry's score
+#define get_hash_score(data) ((int)((data) >> 40) - 0x800000)
+
+/*
+    Lockless hashing: entries are shared between search threads without locks.
+    Entry's key is stored XORed with its data, so if two threads write the same
+    entry simultaneously the torn entry fails key verification and gets ignored
+*/
+
+// transposition table entry
+typedef struct {
+    // position's hash key XOR data
+    unsigned long long hash_key;
+    
+    // encoded best move, flag, depth, age & score
+    unsigned long long data;
+} tt_entry;
+
+// transposition table bucket (entries sharing the same index)
+typedef struct {
+    tt_entry entries[bucket_size];
+} tt_bucket;
+
+// transposition table
+tt_bucket *hash_table = NULL;
+
+// number of hash table buckets (power of 2) minus 1
+unsigned long long hash_mask = 0;
+
+// hash table size in bytes
+size_t hash_table_size = 0;
+
+// current search age (incremented on every "go" command)
+int hash_age = 0;
+
+// allocate memory backed by huge pages where available
+static void *allocate_large_pages(size_t size)
+{
+    #ifdef WIN64
+        // large page size (0 if not supported)
+        size_t large_page = GetLargePageMinimum();
+        
+        // try large pages first (requires "Lock pages in memory" privilege)
+        if (large_page && !(size % large_page))
+        {
+            void *memory = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            
+            if (memory)
+                return memory;
+        }
+        
+        // fall back to regular pages
+        return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    #else
+        // 2MB aligned memory is eligible for transparent huge pages
+        size_t alignment = 2 * 1024 * 1024;
+        
+        // aligned_alloc() requires size to be a multiple of alignment
+        void *memory = aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+        
+        #ifdef MADV_HUGEPAGE
+            // ask the kernel to back hash table with huge pages
+            if (memory)
+                madvise(memory, size, MADV_HUGEPAGE);
+        #endif
+        
+        return memory;
+    #endif
+}
+
+// free memory allocated by allocate_large_pages()
+static void free_large_pages(void *memory)
+{
+    #ifdef WIN64
+        if (memory)
+            VirtualFree(memory, 0, MEM_RELEASE);
+    #else
+        free(memory);
+    #endif
+}
+
+// hash table usage by the current search in permill (sampled from the first 1000 entries)
+int get_hash_full()
+{
+    // number of entries written by the current search
+    int used = 0;
+    
+    // loop over sampled buckets
+    for (int index = 0; index < 1000 / bucket_size; index++)
+        for (int entry = 0; entry < bucket_size; entry++)
+            if (hash_table[index].entries[entry].data &&
+                get_hash_age(hash_table[index].entries[entry].data) == hash_age)
+                used++;
+    
+    return used * 1000 / (1000 / bucket_size * bucket_size);
+}
+
+// clear hash table
+void clear_hash_table()
+{
+    // reset hash table entries
+    memset(hash_table, 0, hash_table_size);
+    
+    // reset search age
+    hash_age = 0;
+    
+    // let search threads clear their pawn hash tables
+    hash_table_clears++;
+}
+
+// init hash table with given size in MB
+void init_hash_table(int mb)
+{
+    // number of buckets fitting into given size
+    unsigned long long bucket_count = 1;
+    
+    // round number of buckets down to the power of 2
+    while (bucket_count * 2 * sizeof(tt_bucket) <= (unsigned long long)mb * 1024 * 1024)
+        bucket_count *= 2;
+    
+    // free previously allocated hash table
+    free_large_pages(hash_table);
+    
+    // allocate hash table
+    hash_table_size = bucket_count * sizeof(tt_bucket);
+    hash_table = allocate_large_pages(hash_table_size);
+    
+    // on allocation failure
+    if (hash_table == NULL)
+    {
+        printf("info string failed to allocate %d MB hash, trying %d MB\n", mb, mb / 2);
+        
+        // try half the size
+        init_hash_table(mb / 2);
+        return;
+    }
+    
+    // init hash mask
+    hash_mask = bucket_count - 1;
+    
+    // clear hash table
+    clear_hash_table();
+}
+
+// read hash entry data
+static inline int read_hash_entry(int alpha, int beta, int depth, int *best_move)
+{
+    // pick up the bucket storing current position
+    tt_bucket *bucket = &hash_table[hash_key & hash_mask];
+    
+    // loop over bucket entries
+    for (int index = 0; index < bucket_size; index++)
+    {
+        // init hash entry data (read only once since other threads may overwrite it)
+        unsigned long long data = bucket->entries[index].data;
+        
+        // make sure we're dealing with the exact position we need
+        if ((bucket->entries[index].hash_key ^ data) == hash_key)
+        {
+
+            // store best move to search it first
+            *best_move = get_hash_move(data);
+            
+            // make sure that we match the exact depth our search is now at
+            if (get_hash_depth(data) >= depth)
+            {
+                // init hash entry score
+                int score = get_hash_score(data);
+                
+                // retrieve mate score independent from the actual path from root to current position
+                if (score < -mate_score) score += ply;
+                if (score > mate_score) score -= ply;
+                
+                // match the exact (PV node) score 
+                if (get_hash_flag(data) == hash_flag_exact)
+                    return score;
+                
+                // match alpha (fail-low node) score
+                if ((get_hash_flag(data) == hash_flag_alpha) && (score <= alpha))
+                    return alpha;
+                
+                // match beta (fail-high node) score
+                if ((get_hash_flag(data) == hash_flag_beta) && (score >= beta))
+                    return beta;
+            }
+            
+            break;
+        }
+    }
+    
+    // if hash entry doesn't exist
+    return no_hash_entry;
+}
+
+// write hash entry data
+static inline void write_hash_entry(int score, int depth, int best_move, int hash_flag)
+{
+    // pick up the bucket storing current position
+    tt_bucket *bucket = &hash_table[hash_key & hash_mask];
+    
+    // entry to replace
+    tt_entry *replace = &bucket->entries[0];
+    
+    // lowest replacement score found so far
+    int replace_score = 1000;
+    
+    // loop over bucket entries
+    for (int index = 0; index < bucket_size; index++)
+    {
+        // init current entry
+        tt_entry *entry = &bucket->entries[index];
+        
+        // init current entry data
+        unsigned long long data = entry->data;
+        
+        // always overwrite the same position
+        if ((entry->hash_key ^ data) == hash_key)
+        {
+            // unless it holds a deeper bound from the current search
+            if (depth < get_hash_depth(data) && get_hash_age(data) == hash_age && hash_flag != hash_flag_exact)
+                return;
+            
+            // preserve old best move if we've got none
+            if (!best_move)
+                best_move = get_hash_move(data);
+            
+            replace = entry;
+            break;
+        }
+        
+        // prefer replacing entries from older searches, then shallower ones
+        int age_distance = (hash_age - get_hash_age(data)) & 0xff;
+        int entry_score = data ? get_hash_depth(data) - 8 * age_distance : -1000;
+        
+        if (entry_score < replace_score)
+        {
+            replace_score = entry_score;
+            replace = entry;
+        }
+    }
+    
+    // store mate score independent from the actual path from root to current position
+    if (score < -mate_score) score -= ply;
+    if (score > mate_score) score += ply;
+    
+    // encode hash entry data
+    unsigned long long data = encode_hash_data(best_move, hash_flag, depth, hash_age, score);
+    
+    // write hash entry data
+    replace->hash_key = hash_key ^ data;
+    replace->data = data;
+}
+
+
+/***********************************************\
+
+                 SEARCH FUNCTIONS
+
+\***********************************************/
+
+// most valuable victim & less valuable attacker
+
+/*
+                          
+    (Victims) Pawn Knight Bishop   Rook  Queen   King
+  (Attackers)
+        Pawn   105    205    305    405    505    605
+      Knight   104    204    304    404    504    604
+      Bishop   103    203    303    403    503    603
+        Rook   102    202    302    402    502    602
+       Queen   101    201    301    401    501    601
+        King   100    200    300    400    500    600
+
+*/
+
+static int mvv_lva[13][13] = {
+	0,   0,   0,   0,   0,   0,   0,  0,   0,   0,   0,   0,   0,
+	0, 105, 205, 305, 405, 505, 605,  105, 205, 305, 405, 505, 605,
+	0, 104, 204, 304, 404, 504, 604,  104, 204, 304, 404, 504, 604,
+	0, 103, 203, 303, 403, 503, 603,  103, 203, 303, 403, 503, 603,
+	0, 102, 202, 302, 402, 502, 602,  102, 202, 302, 402, 502, 602,
+	0, 101, 201, 301, 401, 501, 601,  101, 201, 301, 401, 501, 601,
+	0, 100, 200, 300, 400, 500, 600,  100, 200, 300, 400, 500, 600,
+
+	0, 105, 205, 305, 405, 505, 605,  105, 205, 305, 405, 505, 605,
+	0, 104, 204, 304, 404, 504, 604,  104, 204, 304, 404, 504, 604,
+	0, 103, 203, 303, 403, 503, 603,  103, 203, 303, 403, 503, 603,
+	0, 102, 202, 302, 402, 502, 602,  102, 202, 302, 402, 502, 602,
+	0, 101, 201, 301, 401, 501, 601,  101, 201, 301, 401, 501, 601,
+	0, 100, 200, 300, 400, 500, 600,  100, 200, 300, 400, 500, 600
+};
+
+// killer moves [id][ply]
+__thread int killer_moves[2][max_ply];
+
+// history moves [piece][square]
+__thread int history_moves[13][128];
+
+// PV moves
+__thread int pv_table[max_ply][max_ply];
+__thread int pv_length[max_ply];
+
+// stop search flag (shared by all search threads)
+volatile int stop_search = 0;
+
+// safety margin for GUI & OS lag in milliseconds
+#define move_overhead 50
+
+// time control flag (0 on fixed depth & infinite searches)
+int time_set = 0;
+
+// infinite search flag ("go infinite", bestmove is sent only after "stop")
+int infinite_search = 0;
+
+// search start time
+long long start_time = 0;
+
+// don't start a new iteration after this time
+long long soft_stop_time = 0;
+
+// abort the search after this time
+long long stop_time = 0;
+
+// abort the search after this many nodes of all threads ("go nodes", 0 = no limit)
+long search_node_limit = 0;
+
+// minimal interval between periodic info outputs (ms)
+#define info_interval 1000
+
+// time of the last periodic info output
+long long last_info_time = 0;
+
+// main search thread flag (only main thread talks to the GUI)
+__thread int main_thread = 0;
+
+// selective search depth (the deepest ply reached including quiescence search)
+__thread int seldepth = 0;
+
+// helper thread's nodes count visible to the main thread
+__thread volatile long *shared_nodes = NULL;
+
+// private search limits of threads searching on their own (EPD solver workers, 0 = no limit)
+__thread long long thread_stop_time = 0;
+__thread long thread_node_limit = 0;
+
+// private stop flag (set on reaching private limits)
+__thread int thread_stop = 0;
+
+// drop UCI search limits ("go" sets them for a single search)
+void clear_search_limits()
+{
+    // no time control, infinite search or nodes limit
+    time_set = 0;
+    infinite_search = 0;
+    search_node_limit = 0;
+    soft_stop_time = 0;
+    stop_time = 0;
+}
+
+// get nodes count of all search threads
+long get_total_nodes();
+
+// check if time is up (called every 2048 nodes)
+static inline void check_time()
+{
+    // publish helper thread's nodes count
+    if (shared_nodes)
+        *shared_nodes = nodes;
+    
+    // current time
+    long long current_time = get_time_ms();
+    
+    // stop search on running out of time
+    if (time_set && current_time > stop_time)
+        stop_search = 1;
+    
+    // stop search on reaching nodes limit (main thread sums up all threads)
+    if (search_node_limit && main_thread && get_total_nodes() >= search_node_limit)
+        stop_search = 1;
+    
+    // stop private search on reaching its limits
+    if ((thread_stop_time && current_time > thread_stop_time) ||
+        (thread_node_limit && nodes >= thread_node_limit))
+        thread_stop = 1;
+    
+    // let the GUI know search is alive during long iterations
+    if (main_thread && current_time - last_info_time >= info_interval)
+    {
+        // elapsed time
+        long long time = current_time - start_time;
+        long total_nodes = get_total_nodes();
+        
+        printf("info nodes %ld nps %lld time %lld hashfull %d\n", total_nodes,
+               time ? total_nodes * 1000LL / time : 0, time, get_hash_full());
+        
+        fflush(stdout);
+        
+        last_info_time = current_time;
+    }
+}
+
+// score move for move ordering
+static inline int score_move(int move, int best_move)
+{
+    // best move from hash table
+    if (best_move == move)
+        // score 30000 ( search it before PV move )
+        return 30000;
+    
+    // PV move
+    if (pv_table[0][ply] == move)
+        // score 20000 ( search it first )
+        return 20000;
+ 
+    // init current move score
+    int score;
+    
+    // score MVV LVA (scores 0 for quiete moves)
+    score = mvv_lva[board[get_move_source(move)]][board[get_move_target(move)]];         
+
+    // on capture
+    if (get_move_capture(move))
+    {
+        // add 10000 to current score
+        score += 10000;
+    }
+    
+    // on quiete move
+    else {
+        // on 1st killer move
+        if (killer_moves[0][ply] == move)
+            // score 9000
+            score = 9000;
+        
+        // on 2nd killer move
+        else if (killer_moves[1][ply] == move)
+            // score 8000
+            score = 8000;
+                      
+        // on history move (previous alpha's best score)
+        else
+            // score with history depth
+            score = history_moves[board[get_move_source(move)]][get_move_target(move)] + 7000;
+    }
+    
+    // return move score
+    return score;
+}
+
+static inline void sort_moves(moves *move_list, int best_move)
+{
+    // define move scores array
+    int move_scores[move_list->count];
+    
+    // init move scores array
+    for (int count = 0; count < move_list->count; count++)
+        // score move
+        move_scores[count] = score_move(move_list->moves[count], best_move);
+    
+    // loop over current move score
+    for (int current = 0; current < move_list->count; current++)
+    {
+        // loop over next move score
+        for (int next = current + 1; next < move_list->count; next++)
+        {
+            // order moves descending
+            if (move_scores[current] < move_scores[next])
+            {
+                // swap scores
+                int temp_score = move_scores[current];
+                move_scores[current] = move_scores[next];
+                move_scores[next] = temp_score;
+                
+                // swap corresponding moves
+                int temp_move = move_list->moves[current];
+                move_list->moves[current] = move_list->moves[next];
+                move_list->moves[next] = temp_move;
+            }
+        }
+    }    
+}
+
+// quiescence search
+static inline int quiescence_search(int alpha, int beta, int depth)
+{
+    // update nodes count
+    nodes++;
+    update_stats(quiescence_nodes);
+    
+    // update selective depth
+    if (ply > seldepth)
+        seldepth = ply;
+    
+    // check time every 2048 nodes
+    if (!(nodes & 2047))
+        check_time();
+    
+    // return if search has been stopped (score is ignored anyway)
+    if (stop_search || thread_stop)
+        return 0;
+    
+    // we are too deep, hence there's an overflow of arrays relying on max ply constant
+    if (ply > max_ply - 1)
+        return evaluate_position();
+    
+    // best move (to store in hash table)
+    int best_move = 0;
+    
+    // old alpha
+    int old_alpha = alpha;
+    
+    // read hash entry
+    int hash_score = read_hash_entry(alpha, beta, 0, &best_move);
+    
+    // if the move has already been searched return its score
+    if (hash_score != no_hash_entry)
+        return hash_score;
+    
+    // evaluate position
+    int eval = evaluate_position();
+    
+    //  fail hard beta-cutoff
+    if (eval >= beta)
+        return beta;
+
+    // alpha acts like max in MiniMax
+    if (eval > alpha)
+        alpha = eval;
+
+    // create move list variable
+    moves move_list[1];
+    
+    // generate captures & promotions
+    generate_captures(move_list);
+    
+    // move ordering
+    sort_moves(move_list, best_move);
+    
+    // find checkers & pinned pieces
+    legality info[1];
+    init_legality(info);
+    
+    // loop over the generated moves
+    for (int count = 0; count < move_list->count; count++)
+    {      
+        // skip captures losing material
+        if (is_bad_capture(move_list->moves[count]))
+            continue;
+        
+        // skip illegal moves
+        if (!is_legal(info, move_list->moves[count]))
+        {
+            update_stats(illegal_moves);
+            continue;
+        }
+        
+        // increment ply
+        ply++;
+        
+        // make legal move
+        play_move(move_list->moves[count]);
+        
+        // recursive call
+        int score = -quiescence_search(-beta, -alpha, depth);
+        
+        // take move back
+        unmake_move();
+        
+        // decrement ply
+        ply--;
+        
+        // don't trust the scores of stopped search
+        if (stop_search || thread_stop)
+            return 0;
+        
+        //  fail hard beta-cutoff
+        if (score >= beta)
+        {
+            // store hash entry with the score equal to beta
+            write_hash_entry(beta, 0, move_list->moves[count], hash_flag_beta);
+            
+            return beta;
+        }
+        
+        // alpha acts like max in MiniMax
+        if (score > alpha)
+        {
+            // set alpha score
+            alpha = score;
+            
+            // store current best move
+            best_move = move_list->moves[count];
+        }
+    }
+    
+    // store hash entry with the score equal to alpha
+    write_hash_entry(alpha, 0, best_move, (alpha > old_alpha) ? hash_flag_exact : hash_flag_alpha);
+    
+    // return alpha score
+    return alpha;
+}
+
+/*
+    Null move pruning: if side to move is still above beta after passing the
+    turn and a reduced depth search, a real move would most likely fail high
+    too. It's unsafe in zugzwang, so it's skipped in check, with pawns only
+    and right after another null move. The reduction grows with depth
+*/
+
+// null move pruning switch & base depth reduction (UCI "NullMove" & "NullMoveReduction" options)
+int null_move_pruning = 1;
+int null_move_reduction = 2;
+
+// does side have pieces other than pawns & king
+static inline int has_non_pawn_material(int side)
+{
+    return !side ? piece_count[N] + piece_count[B] + piece_count[R] + piece_count[Q] :
+                   piece_count[n] + piece_count[b] + piece_count[r] + piece_count[q];
+}
+
+/*
+    Late move reductions: quiet moves ordered after hash, PV, tactical and
+    killer moves rarely raise alpha, so they are searched with reduced depth
+    (growing with log of depth times log of move number) and null window.
+    The ones that fail high anyway are re-searched at full depth
+*/
+
+// late move reductions [depth][move number]
+int reduction_table[max_ply][64];
+
+// init late move reductions table
+void init_reductions()
+{
+    // loop over depths
+    for (int depth = 1; depth < max_ply; depth++)
+    {
+        // loop over move numbers
+        for (int move_number = 1; move_number < 64; move_number++)
+            // log based reduction
+            reduction_table[depth][move_number] = (int)(0.75 + log(depth) * log(move_number) / 2.25);
+    }
+}
+
+/*
+    Staged move picker: instead of generating, scoring and sorting all the
+    moves up front, negamax takes them one by one. Hash and PV moves are tried
+    before any generation, captures & promotions are picked best first, then
+    killers, and quiet moves are generated only if none of those caused a cutoff.
+    Captures losing material by SEE are left for the very end
+*/
+
+// move picker stages
+enum picker_stages {
+    stage_hash_move, stage_pv_move, stage_generate_captures, stage_captures,
+    stage_killers, stage_generate_quiets, stage_quiets, stage_bad_captures, stage_done
+};
+
+// move picker
+typedef struct {
+    // current stage
+    int stage;
+    
+    // moves tried before generation
+    int hash_move;
+    int pv_move;
+    
+    // killer moves index
+    int killer_index;
+    
+    // generated moves & their scores
+    moves move_list[1];
+    int move_scores[256];
+    
+    // next move to pick in the list
+    int index;
+    
+    // losing captures (tried after quiet moves)
+    moves bad_captures[1];
+    int bad_index;
+} move_picker;
+
+// init move picker
+static inline void init_move_picker(move_picker *picker, int hash_move)
+{
+    picker->stage = stage_hash_move;
+    picker->hash_move = hash_move;
+    picker->pv_move = 0;
+    picker->killer_index = 0;
+    picker->bad_captures->count = 0;
+    picker->bad_index = 0;
+}
+
+// has the move been tried before generation
+static inline int is_special_move(move_picker *picker, int move)
+{
+    return move == picker->hash_move || move == picker->pv_move ||
+           move == killer_moves[0][ply] || move == killer_moves[1][ply];
+}
+
+// pick the best scored remaining move from the list
+static inline int pick_best_move(move_picker *picker)
+{
+    // no moves left
+    if (picker->index >= picker->move_list->count)
+        return 0;
+    
+    // find best move
+    int best = picker->index;
+    
+    for (int count = picker->index + 1; count < picker->move_list->count; count++)
+        if (picker->move_scores[count] > picker->move_scores[best])
+            best = count;
+    
+    // take best move
+    int move = picker->move_list->moves[best];
+    
+    // move remaining move into its place
+    picker->move_list->moves[best] = picker->move_list->moves[picker->index];
+    picker->move_scores[best] = picker->move_scores[picker->index];
+    
+    // next move
+    picker->index++;
+    
+    return move;
+}
+
+// pick next move (returns 0 when no moves left)
+static inline int pick_next_move(move_picker *picker)
+{
+    // current move
+    int move;
+    
+    switch (picker->stage)
+    {
+        // hash move
+        case stage_hash_move:
+            picker->stage++;
+            
+            if (picker->hash_move && is_pseudo_legal(picker->hash_move))
+                return picker->hash_move;
+            
+            // hash move is not valid here
+            picker->hash_move = 0;
+            
+            // fall through
+        
+        // PV move
+        case stage_pv_move:
+            picker->stage++;
+            
+            move = pv_table[0][ply];
+            
+            if (move && move != picker->hash_move && is_pseudo_legal(move))
+                return picker->pv_move = move;
+            
+            // fall through
+        
+        // generate captures & promotions
+        case stage_generate_captures:
+            picker->stage++;
+            
+            generate_captures(picker->move_list);
+            picker->index = 0;
+            
+            // score MVV LVA (promoted piece is treated as a victim)
+            for (int count = 0; count < picker->move_list->count; count++)
+            {
+                move = picker->move_list->moves[count];
+                
+                picker->move_scores[count] = mvv_lva[board[get_move_source(move)]][board[get_move_target(move)]] +
+                                             mvv_lva[board[get_move_source(move)]][get_move_piece(move)];
+            }
+            
+            // fall through
+        
+        // captures & promotions best first
+        case stage_captures:
+            while ((move = pick_best_move(picker)))
+            {
+                // skip moves tried already
+                if (move == picker->hash_move || move == picker->pv_move)
+                    continue;
+                
+                // postpone losing captures
+                if (is_bad_capture(move))
+                {
+                    add_move(picker->bad_captures, move);
+                    continue;
+                }
+                
+                return move;
+            }
+            
+            picker->stage++;
+            
+            // fall through
+        
+        // killer moves
+        case stage_killers:
+            while (picker->killer_index < 2)
+            {
+                move = killer_moves[picker->killer_index++][ply];
+                
+                // quiet killers only (tactical ones have been tried already)
+                if (move && move != picker->hash_move && move != picker->pv_move &&
+                    !get_move_capture(move) && !get_move_piece(move) &&
+                    (picker->killer_index == 1 || move != killer_moves[0][ply]) && is_pseudo_legal(move))
+                    return move;
+            }
+            
+            picker->stage++;
+            
+            // fall through
+        
+        // generate quiet moves
+        case stage_generate_quiets:
+            picker->stage++;
+            
+            generate_moves(picker->move_list);
+            picker->index = 0;
+            
+            // keep quiet moves that haven't been tried yet
+            int quiet_count = 0;
+            
+            for (int count = 0; count < picker->move_list->count; count++)
+            {
+                move = picker->move_list->moves[count];
+                
+                // skip tactical & already tried moves
+                if (get_move_capture(move) || get_move_piece(move) || is_special_move(picker, move))
+                    continue;
+                
+                // score history
+                picker->move_list->moves[quiet_count] = move;
+                picker->move_scores[quiet_count++] = history_moves[board[get_move_source(move)]][get_move_target(move)];
+            }
+            
+            picker->move_list->count = quiet_count;
+            
+            // fall through
+        
+        // quiet moves by history
+        case stage_quiets:
+            if ((move = pick_best_move(picker)))
+                return move;
+            
+            picker->stage++;
+            
+            // fall through
+        
+        // losing captures in MVV LVA order
+        case stage_bad_captures:
+            if (picker->bad_index < picker->bad_captures->count)
+                return picker->bad_captures->moves[picker->bad_index++];
+            
+            picker->stage++;
+    }
+    
+    // no more moves
+    return 0;
+}
+
+#ifdef STATS
+
+// get stage of the move picker the last picked move comes from
+static inline int get_cutoff_stage(move_picker *picker)
+{
+    switch (picker->stage)
+    {
+        case stage_pv_move: return cutoff_hash;
+        case stage_generate_captures: return cutoff_pv;
+        case stage_captures: return cutoff_capture;
+        case stage_killers: return picker->killer_index == 1 ? cutoff_killer_1 : cutoff_killer_2;
+        case stage_quiets: return cutoff_history;
+        default: return cutoff_bad_capture;
+    }
+}
+
+#endif
+
+// negamax search
+static inline int negamax_search(int alpha, int beta, int depth)
+{       
+    // legal moves
+    int legal_moves = 0;
+    
+    // best move (to store in hash table)
+    int best_move = 0;
+    
+    // old alpha
+    int old_alpha = alpha;
+    
+    // PV length
+    pv_length[ply] = ply;
+    
+    // update selective depth
+    if (ply > seldepth)
+        seldepth = ply;
+    
+    // draw by repetition or fifty move rule (not in the root node since we need a move from there)
+    if (ply && (fifty >= 100 || is_repetition()))
+        return 0;
+
+    // escape condition
+    if  (!depth)
+        // search for calm position before evaluation
+        return quiescence_search(alpha, beta, depth);
+    
+    // return if search has been stopped (score is ignored anyway)
+    if (stop_search || thread_stop)
+        return 0;
+    
+    // we are too deep, hence there's an overflow of arrays relying on max ply constant
+    if (ply > max_ply - 2)
+        return evaluate_position();
+    
+    // read hash entry (not in the root node since we need PV from there)
+    int hash_score = ply ? read_hash_entry(alpha, beta, depth, &best_move) : no_hash_entry;
+    
+    // if the move has already been searched return its score
+    if (hash_score != no_hash_entry)
+        return hash_score;
+
+    // update nodes count
+    nodes++;
+    update_stats(main_nodes);
+    
+    // check time every 2048 nodes
+    if (!(nodes & 2047))
+        check_time();
+    
+    // find checkers & pinned pieces
+    legality info[1];
+    init_legality(info);
+    
+    // is king in check?
+    int in_check = info->checkers > 0;
+    
+    // increase depth if king is in check
+    if (in_check)
+        depth++;
+    
+    // null move pruning (not in root, in check, with pawns only or after another null move)
+    if (null_move_pruning && ply && depth >= 3 && !in_check && has_non_pawn_material(side) &&
+        undo_count && undo_stack[undo_count - 1].move && evaluate_position() >= beta)
+    {
+        // adaptive reduction
+        int reduction = null_move_reduction + depth / 6;
+        
+        // pass the turn
+        ply++;
+        make_null_move();
+        update_stats(null_move_tries);
+        
+        // search with reduced depth & null window around beta
+        int score = -negamax_search(-beta, -beta + 1, depth - 1 - reduction > 0 ? depth - 1 - reduction : 0);
+        
+        // take null move back
+        unmake_null_move();
+        ply--;
+        
+        // don't trust the scores of stopped search
+        if (stop_search || thread_stop)
+            return 0;
+        
+        // fail hard beta-cutoff
+        if (score >= beta)
+        {
+            update_stats(null_move_cutoffs);
+            return beta;
+        }
+    }
+    
+    // init move picker
+    move_picker picker[1];
+    init_move_picker(picker, best_move);
+    
+    // current move
+    int move;
+    
+    // loop over the picked moves
+    while ((move = pick_next_move(picker)))
+    {
+        // skip illegal moves
+        if (!is_legal(info, move))
+        {
+            update_stats(illegal_moves);
+            continue;
+        }
+        
+        // report root move on long searches
+        if (!ply && main_thread && get_time_ms() - start_time > info_interval)
+        {
+            printf("info depth %d currmove %s%s%s currmovenumber %d\n", depth,
+                   square_to_coords[get_move_source(move)],
+                   square_to_coords[get_move_target(move)],
+                   promoted_pieces[get_move_piece(move)], legal_moves + 1);
+            
+            fflush(stdout);
+        }
+        
+        // increment ply
+        ply++;
+        
+        // make legal move
+        play_move(move);
+         
+        // increment legal moves
+        legal_moves++;
+        
+        // current move score
+        int score;
+        
+        // first move is searched with full window
+        if (legal_moves == 1)
+            score = -negamax_search(-beta, -alpha, depth - 1);
+        
+        // principal variation search
+        else
+        {
+            // reduce late quiet moves (not in check or giving check)
+            int reduction = 0;
+            
+            if (depth >= 3 && legal_moves > 3 && picker->stage == stage_quiets && !in_check &&
+                !is_square_attacked(king_square[side], side ^ 1))
+            {
+                // look up reduction
+                reduction = reduction_table[depth < max_ply ? depth : max_ply - 1][legal_moves < 64 ? legal_moves : 63];
+                
+                // leave at least one ply to search
+                if (reduction > depth - 2)
+                    reduction = depth - 2;
+            }
+            
+            // null window search to prove the move is worse than alpha
+            score = -negamax_search(-alpha - 1, -alpha, depth - 1 - reduction);
+            
+            // reduced move beats alpha, re-search it at full depth
+            if (reduction && score > alpha)
+                score = -negamax_search(-alpha - 1, -alpha, depth - 1);
+            
+            // move beats alpha within the window, re-search it with full window
+            if (score > alpha && score < beta)
+                score = -negamax_search(-beta, -alpha, depth - 1);
+        }
+        
+        // take move back
+        unmake_move();
+        
+        // decrement ply
+        ply--;
+        
+        // don't trust the scores of stopped search
+        if (stop_search || thread_stop)
+            return 0;
+
+        //  fail hard beta-cutoff
+        if (score >= beta)
+        {
+            // count cutoffs
+            update_stats(fail_highs);
+            update_stats(cutoffs[get_cutoff_stage(picker)]);
+            
+            if (legal_moves == 1)
+                update_stats(first_move_fail_highs);
+            
+            // update killer moves
+            killer_moves[1][ply] = killer_moves[0][ply];
+            killer_moves[0][ply] = move;
+            
+            // store hash entry with the score equal to beta
+            write_hash_entry(beta, depth, move, hash_flag_beta);
+            
+            return beta;
+        }
+        
+        // alpha acts like max in MiniMax
+        if (score > alpha)
+        {
+            // update history score
+            history_moves[board[get_move_source(move)]][get_move_target(move)] += depth;
+
+            // set alpha score
+            alpha = score;
+            
+            // store PV move
+			pv_table[ply][ply] = move;
+			
+			for (int i = ply + 1; i < pv_length[ply + 1]; i++)
+				pv_table[ply][i] = pv_table[ply + 1][i];
+	
+			pv_length[ply] = pv_length[ply + 1];
+            
+            // store current best move
+            best_move = move;
+        }      
+    }
+    
+    // if no legal moves
+    if (!legal_moves)
+    {
+        // check mate detection
+        if (in_check)
+            return -mate_value + ply;
+        
+        // stalemate detection
+        else
+            return 0;
+    }
+    
+    // store hash entry with the score equal to alpha
+    write_hash_entry(alpha, depth, best_move, (alpha > old_alpha) ? hash_flag_exact : hash_flag_alpha);
+    
+    // return alpha score
+    return alpha;
+}
+
+/*
+    Lazy SMP: helper threads search the same root position on their private
+    boards while sharing results through the lockless transposition table.
+    Helpers don't report anything, main thread decides when to stop them
+*/
+
+// max number of search threads
+#define max_threads 256
+
+// search thread data
+typedef struct {
+    // thread handle
+    pthread_t handle;
+    
+    // thread index (0 is the main thread)
+    int id;
+    
+    // is helper thread running (thread creation may fail)
+    int running;
+    
+    // position to search
+    board_state root;
+    
+    // nodes searched by helper thread so far
+    volatile long nodes;
+} search_thread;
+
+// search threads
+search_thread threads[max_threads];
+
+// number of search threads (UCI "Threads" option)
+int thread_count = 1;
+
+// clear search heuristics
+static inline void clear_search_tables()
+{
+    // reset half move
+    ply = 0;
+    
+    // positions below current one are game history
+    root_undo_count = undo_count;
+    
+    // clear PV, killer and history moves
+    memset(pv_table, 0, 16384);  // sizeof(pv_table)
+    memset(killer_moves, 0, 512);  // sizeof(killer_moves)
+    memset(history_moves, 0, 6656);  // sizeof(history_moves)
+    
+    // set up pawn hash table
+    init_pawn_hash_table();
+}
+
+// helper thread search
+void *helper_search(void *thread_data)
+{
+    // init current thread data
+    search_thread *thread = thread_data;
+    
+    // set up private board
+    restore_board_state(&thread->root);
+    
+    // init private nodes count & search heuristics
+    nodes = 0;
+    shared_nodes = &thread->nodes;
+    clear_search_tables();
+    
+    // iterative deepening until stopped (odd helpers skip depth 1 to desynchronize threads)
+    for (int current_depth = 1 + (thread->id & 1); current_depth < max_ply && !stop_search; current_depth++)
+    {
+        // search position with current depth
+        negamax_search(-50000, 50000, current_depth);
+        
+        // publish nodes count
+        thread->nodes = nodes;
+    }
+    
+    // publish final nodes count
+    thread->nodes = nodes;
+    
+    // free private pawn hash table
+    free_pawn_hash_table();
+    
+    return NULL;
+}
+
+// start helper threads
+void start_helper_threads()
+{
+    // loop over helper threads
+    for (int id = 1; id < thread_count; id++)
+    {
+        // init helper thread data
+        threads[id].id = id;
+        threads[id].nodes = 0;
+        save_board_state(&threads[id].root);
+        
+        // run helper search (main thread searches alone if no helper can be created)
+        threads[id].running = !pthread_create(&threads[id].handle, NULL, helper_search, &threads[id]);
+    }
+}
+
+// stop helper threads
+void stop_helper_threads()
+{
+    // signal helpers to stop (the flag is reset before the next search)
+    stop_search = 1;
+    
+    // wait for running helpers to finish
+    for (int id = 1; id < thread_count; id++)
+    {
+        if (threads[id].running)
+            pthread_join(threads[id].handle, NULL);
+        
+        threads[id].running = 0;
+    }
+}
+
+// get nodes count of all search threads
+long get_total_nodes()
+{
+    // init nodes with main thread's count
+    long total_nodes = nodes;
+    
+    // add nodes searched by helper threads
+    for (int id = 1; id < thread_count; id++)
+        total_nodes += threads[id].nodes;
+    
+    return total_nodes;
+}
+
+// UCI debug mode (search statistics are sent as info strings)
+int debug_mode = 0;
+
+// print search statistics of the main thread
+void print_search_stats()
+{
+    #ifdef STATS
+        // move ordering, pruning & pawn hash statistics
+        print_statistics(&stats);
+    #else
+        printf("info string search statistics are disabled (build with -DSTATS)\n");
+    #endif
+}
+
+// initial aspiration window half width around previous iteration's score
+#define aspiration_window 100
+
+// first iteration searched with aspiration window (shallower ones are too unstable)
+#define aspiration_depth 5
+
+// format score as in UCI info ("cp <centipawns>" or "mate <moves>", negative when getting mated)
+void format_score(int score, char *text)
+{
+    if (score > mate_score)
+        sprintf(text, "mate %d", (mate_value - score + 1) / 2);
+    
+    else if (score < -mate_score)
+        sprintf(text, "mate %d", -(mate_value + score) / 2);
+    
+    else
+        sprintf(text, "cp %d", score);
+}
+
+// print search info of finished (or failed) iteration except PV
+void print_search_info(int depth, int score, char *bound)
+{
+    // elapsed time
+    long long time = get_time_ms() - start_time;
+    long total_nodes = get_total_nodes();
+    
+    // selective depth is the deepest ply reached by any node of the iteration (hash cutoffs may keep it below depth)
+    printf("info depth %d seldepth %d ", depth, seldepth);
+    
+    // mate scores are reported in moves
+    char score_text[32];
+    format_score(score, score_text);
+    
+    printf("score %s%s nodes %ld nps %lld time %lld hashfull %d", score_text, bound, total_nodes,
+           time ? total_nodes * 1000LL / time : 0, time, get_hash_full());
+    
+    // iteration info postpones periodic one
+    last_info_time = get_time_ms();
+}
+
+// search position
+int search_position(int depth)
+{
+    // init nodes count
+    nodes = 0;
+    
+    // this thread reports search progress
+    main_thread = 1;
+    last_info_time = get_time_ms();
+    
+    #ifdef STATS
+        // reset search statistics
+        memset(&stats, 0, sizeof(stats));
+    #endif
+    
+    // new search makes hash entries from previous searches older
+    hash_age = (hash_age + 1) & 0xff;
+    
+    // clear PV, killer and history moves
+    clear_search_tables();
+    
+    // run helper searches in the background
+    start_helper_threads();
+    
+    // best score
+    int score = 0;
+    
+    // iterative deepening
+    for (int current_depth = 1; current_depth <= depth; current_depth++)
+    {    
+        // reset selective depth
+        seldepth = 0;
+        
+        // init aspiration window (full window on shallow depths & mate scores)
+        int delta = aspiration_window;
+        int alpha = -50000, beta = 50000;
+        
+        if (current_depth >= aspiration_depth && abs(score) < mate_score)
+        {
+            alpha = score - delta;
+            beta = score + delta;
+        }
+        
+        // search until score falls inside the window
+        while (1)
+        {
+            // search position with current depth
+            score = negamax_search(alpha, beta, current_depth);
+            
+            // unfinished search is not worth reporting
+            if (stop_search)
+                break;
+            
+            // fail low: widen window down
+            if (score <= alpha && alpha > -50000)
+            {
+                print_search_info(current_depth, score, " upperbound");
+                printf("\n");
+                alpha = (score - delta > -50000) ? score - delta : -50000;
+            }
+            
+            // fail high: widen window up
+            else if (score >= beta && beta < 50000)
+            {
+                print_search_info(current_depth, score, " lowerbound");
+                printf("\n");
+                beta = (score + delta < 50000) ? score + delta : 50000;
+            }
+            
+            // score is exact
+            else
+                break;
+            
+            fflush(stdout);
+            
+            // widen faster on repeated failures
+            delta *= 2;
+        }
+        
+        // unfinished iteration is not worth reporting
+        if (stop_search)
+            break;
+        
+        #ifdef STATS
+            // record nodes count of finished iteration
+            stats.iteration_nodes[current_depth] = nodes;
+            stats.iterations = current_depth;
+        #endif
+        
+        // output best move
+        print_search_info(current_depth, score, "");
+        printf(" pv ");
+        
+        // print PV line
+        for (int i = 0; i < pv_length[0]; i++)
+        {
+            printf("%s%s%s ", square_to_coords[get_move_source(pv_table[0][i])],
+                              square_to_coords[get_move_target(pv_table[0][i])],
+                              promoted_pieces[get_move_piece(pv_table[0][i])]);
+        }
+        
+        printf("\n");
+        fflush(stdout);
+        
+        // next iteration is unlikely to finish in time
+        if (time_set && get_time_ms() > soft_stop_time)
+            break;
+    }
+    
+    // on infinite search bestmove is sent only after "stop" or "quit"
+    while (infinite_search && !stop_search)
+        sleep_ms(1);
+    
+    // main thread is done, so are helpers
+    stop_helper_threads();
+    
+    // limits of this search must not affect the next one (bench, EPD solver, PGN annotator)
+    clear_search_limits();
+    
+    // search has been stopped before the first iteration finished
+    if (!pv_table[0][0])
+    {
+        // create move list variable
+        moves move_list[1];
+        
+        // generate moves
+        generate_moves(move_list);
+        
+        // pick up the first legal move
+        for (int count = 0; count < move_list->count && !pv_table[0][0]; count++)
+        {
+            // make only legal moves
+            if (!make_move(move_list->moves[count], all_moves))
+                continue;
+            
+            // take move back
+            unmake_move();
+            
+            // store legal move
+            pv_table[0][0] = move_list->moves[count];
+        }
+    }
+	
+    #ifdef STATS
+        // keep statistics for "stats" command
+        last_search_stats = stats;
+    #endif
+    
+    // print search statistics
+    if (debug_mode)
+        print_search_stats();
+	
+	// print best move
+    printf("\nbestmove %s%s%s\n", square_to_coords[get_move_source(pv_table[0][0])],
+                                  square_to_coords[get_move_target(pv_table[0][0])],
+                                  promoted_pieces[get_move_piece(pv_table[0][0])]);
+    
+    fflush(stdout);
+}
+
+
+/***********************************************\
+
+              POLYGLOT OPENING BOOK
+
+\***********************************************/
+
+/*
+    Polyglot .bin book is a sorted array of 16 byte big endian entries:
+    
+        key     8 bytes  polyglot hash key of the position
+        move    2 bytes  to file | to row << 3 | from file << 6 | from row << 9 | promotion << 12
+        weight  2 bytes  move weight
+        learn   4 bytes  unused
+    
+    The file is memory mapped and probed with binary search, so opening
+    the book costs nothing and every probe touches a few pages only.
+    Polyglot keys differ from the engine's zobrist keys, they are built
+    from the fixed random table below (part of the book format).
+*/
+
+// polyglot random keys (768 piece keys, 4 castling keys, 8 enpassant keys, 1 side key)
+const unsigned long long polyglot_random[781] = {
+    0x9D39247E33776D41ULL, 0x2AF7398005AAA5C7ULL, 0x44DB015024623547ULL, 0x9C15F73E62A76AE2ULL,
+    0x75834465489C0C89ULL, 0x3290AC3A203001BFULL, 0x0FBBAD1F61042279ULL, 0xE83A908FF2FB60CAULL,
+    0x0D7E765D58755C10ULL, 0x1A083822CEAFE02DULL, 0x9605D5F0E25EC3B0ULL, 0xD021FF5CD13A2ED5ULL,
+    0x40BDF15D4A672E32ULL, 0x011355146FD56395ULL, 0x5DB4832046F3D9E5ULL, 0x239F8B2D7FF719CCULL,
+    0x05D1A1AE85B49AA1ULL, 0x679F848F6E8FC971ULL, 0x7449BBFF801FED0BULL, 0x7D11CDB1C3B7ADF0ULL,
+    0x82C7709E781EB7CCULL, 0xF3218F1C9510786CULL, 0x331478F3AF51BBE6ULL, 0x4BB38DE5E7219443ULL,
+    0xAA649C6EBCFD50FCULL, 0x8DBD98A352AFD40BULL, 0x87D2074B81D79217ULL, 0x19F3C751D3E92AE1ULL,
+    0xB4AB30F062B19ABFULL, 0x7B0500AC42047AC4ULL, 0xC9452CA81A09D85DULL, 0x24AA6C514DA27500ULL,
+    0x4C9F34427501B447ULL, 0x14A68FD73C910841ULL, 0xA71B9B83461CBD93ULL, 0x03488B95B0F1850FULL,
+    0x637B2B34FF93C040ULL, 0x09D1BC9A3DD90A94ULL, 0x3575668334A1DD3BULL, 0x735E2B97A4C45A23ULL,
+    0x18727070F1BD400BULL, 0x1FCBACD259BF02E7ULL, 0xD310A7C2CE9B6555ULL, 0xBF983FE0FE5D8244ULL,
+    0x9F74D14F7454A824ULL, 0x51EBDC4AB9BA3035ULL, 0x5C82C505DB9AB0FAULL, 0xFCF7FE8A3430B241ULL,
+    0x3253A729B9BA3DDEULL, 0x8C74C368081B3075ULL, 0xB9BC6C87167C33E7ULL, 0x7EF48F2B83024E20ULL,
+    0x11D505D4C351BD7FULL, 0x6568FCA92C76A243ULL, 0x4DE0B0F40F32A7B8ULL, 0x96D693460CC37E5DULL,
+    0x42E240CB63689F2FULL, 0x6D2BDCDAE2919661ULL, 0x42880B0236E4D951ULL, 0x5F0F4A5898171BB6ULL,
+    0x39F890F579F92F88ULL, 0x93C5B5F47356388BULL, 0x63DC359D8D231B78ULL, 0xEC16CA8AEA98AD76ULL,
+    0x5355F900C2A82DC7ULL, 0x07FB9F855A997142ULL, 0x5093417AA8A7ED5EULL, 0x7BCBC38DA25A7F3CULL,
+    0x19FC8A768CF4B6D4ULL, 0x637A7780DECFC0D9ULL, 0x8249A47AEE0E41F7ULL, 0x79AD695501E7D1E8ULL,
+    0x14ACBAF4777D5776ULL, 0xF145B6BECCDEA195ULL, 0xDABF2AC8201752FCULL, 0x24C3C94DF9C8D3F6ULL,
+    0xBB6E2924F03912EAULL, 0x0CE26C0B95C980D9ULL, 0xA49CD132BFBF7CC4ULL, 0xE99D662AF4243939ULL,
+    0x27E6AD7891165C3FULL, 0x8535F040B9744FF1ULL, 0x54B3F4FA5F40D873ULL, 0x72B12C32127FED2BULL,
+    0xEE954D3C7B411F47ULL, 0x9A85AC909A24EAA1ULL, 0x70AC4CD9F04F21F5ULL, 0xF9B89D3E99A075C2ULL,
+    0x87B3E2B2B5C907B1ULL, 0xA366E5B8C54F48B8ULL, 0xAE4A9346CC3F7CF2ULL, 0x1920C04D47267BBDULL,
+    0x87BF02C6B49E2AE9ULL, 0x092237AC237F3859ULL, 0xFF07F64EF8ED14D0ULL, 0x8DE8DCA9F03CC54EULL,
+    0x9C1633264DB49C89ULL, 0xB3F22C3D0B0B38EDULL, 0x390E5FB44D01144BULL, 0x5BFEA5B4712768E9ULL,
+    0x1E1032911FA78984ULL, 0x9A74ACB964E78CB3ULL, 0x4F80F7A035DAFB04ULL, 0x6304D09A0B3738C4ULL,
+    0x2171E64683023A08ULL, 0x5B9B63EB9CEFF80CULL, 0x506AACF489889342ULL, 0x1881AFC9A3A701D6ULL,
+    0x6503080440750644ULL, 0xDFD395339CDBF4A7ULL, 0xEF927DBCF00C20F2ULL, 0x7B32F7D1E03680ECULL,
+    0xB9FD7620E7316243ULL, 0x05A7E8A57DB91B77ULL, 0xB5889C6E15630A75ULL, 0x4A750A09CE9573F7ULL,
+    0xCF464CEC899A2F8AULL, 0xF538639CE705B824ULL, 0x3C79A0FF5580EF7FULL, 0xEDE6C87F8477609DULL,
+    0x799E81F05BC93F31ULL, 0x86536B8CF3428A8CULL, 0x97D7374C60087B73ULL, 0xA246637CFF328532ULL,
+    0x043FCAE60CC0EBA0ULL, 0x920E449535DD359EULL, 0x70EB093B15B290CCULL, 0x73A1921916591CBDULL,
+    0x56436C9FE1A1AA8DULL, 0xEFAC4B70633B8F81ULL, 0xBB215798D45DF7AFULL, 0x45F20042F24F1768ULL,
+    0x930F80F4E8EB7462ULL, 0xFF6712FFCFD75EA1ULL, 0xAE623FD67468AA70ULL, 0xDD2C5BC84BC8D8FCULL,
+    0x7EED120D54CF2DD9ULL, 0x22FE545401165F1CULL, 0xC91800E98FB99929ULL, 0x808BD68E6AC10365ULL,
+    0xDEC468145B7605F6ULL, 0x1BEDE3A3AEF53302ULL, 0x43539603D6C55602ULL, 0xAA969B5C691CCB7AULL,
+    0xA87832D392EFEE56ULL, 0x65942C7B3C7E11AEULL, 0xDED2D633CAD004F6ULL, 0x21F08570F420E565ULL,
+    0xB415938D7DA94E3CULL, 0x91B859E59ECB6350ULL, 0x10CFF333E0ED804AULL, 0x28AED140BE0BB7DDULL,
+    0xC5CC1D89724FA456ULL, 0x5648F680F11A2741ULL, 0x2D255069F0B7DAB3ULL, 0x9BC5A38EF729ABD4ULL,
+    0xEF2F054308F6A2BCULL, 0xAF2042F5CC5C2858ULL, 0x480412BAB7F5BE2AULL, 0xAEF3AF4A563DFE43ULL,
+    0x19AFE59AE451497FULL, 0x52593803DFF1E840ULL, 0xF4F076E65F2CE6F0ULL, 0x11379625747D5AF3ULL,
+    0xBCE5D2248682C115ULL, 0x9DA4243DE836994FULL, 0x066F70B33FE09017ULL, 0x4DC4DE189B671A1CULL,
+    0x51039AB7712457C3ULL, 0xC07A3F80C31FB4B4ULL, 0xB46EE9C5E64A6E7CULL, 0xB3819A42ABE61C87ULL,
+    0x21A007933A522A20ULL, 0x2DF16F761598AA4FULL, 0x763C4A1371B368FDULL, 0xF793C46702E086A0ULL,
+    0xD7288E012AEB8D31ULL, 0xDE336A2A4BC1C44BULL, 0x0BF692B38D079F23ULL, 0x2C604A7A177326B3ULL,
+    0x4850E73E03EB6064ULL, 0xCFC447F1E53C8E1BULL, 0xB05CA3F564268D99ULL, 0x9AE182C8BC9474E8ULL,
+    0xA4FC4BD4FC5558CAULL, 0xE755178D58FC4E76ULL, 0x69B97DB1A4C03DFEULL, 0xF9B5B7C4ACC67C96ULL,
+    0xFC6A82D64B8655FBULL, 0x9C684CB6C4D24417ULL, 0x8EC97D2917456ED0ULL, 0x6703DF9D2924E97EULL,
+    0xC547F57E42A7444EULL, 0x78E37644E7CAD29EULL, 0xFE9A44E9362F05FAULL, 0x08BD35CC38336615ULL,
+    0x9315E5EB3A129ACEULL, 0x94061B871E04DF75ULL, 0xDF1D9F9D784BA010ULL, 0x3BBA57B68871B59DULL,
+    0xD2B7ADEEDED1F73FULL, 0xF7A255D83BC373F8ULL, 0xD7F4F2448C0CEB81ULL, 0xD95BE88CD210FFA7ULL,
+    0x336F52F8FF4728E7ULL, 0xA74049DAC312AC71ULL, 0xA2F61BB6E437FDB5ULL, 0x4F2A5CB07F6A35B3ULL,
+    0x87D380BDA5BF7859ULL, 0x16B9F7E06C453A21ULL, 0x7BA2484C8A0FD54EULL, 0xF3A678CAD9A2E38CULL,
+    0x39B0BF7DDE437BA2ULL, 0xFCAF55C1BF8A4424ULL, 0x18FCF680573FA594ULL, 0x4C0563B89F495AC3ULL,
+    0x40E087931A00930DULL, 0x8CFFA9412EB642C1ULL, 0x68CA39053261169FULL, 0x7A1EE967D27579E2ULL,
+    0x9D1D60E5076F5B6FULL, 0x3810E399B6F65BA2ULL, 0x32095B6D4AB5F9B1ULL, 0x35CAB62109DD038AULL,
+    0xA90B24499FCFAFB1ULL, 0x77A225A07CC2C6BDULL, 0x513E5E634C70E331ULL, 0x4361C0CA3F692F12ULL,
+    0xD941ACA44B20A45BULL, 0x528F7C8602C5807BULL, 0x52AB92BEB9613989ULL, 0x9D1DFA2EFC557F73ULL,
+    0x722FF175F572C348ULL, 0x1D1260A51107FE97ULL, 0x7A249A57EC0C9BA2ULL, 0x04208FE9E8F7F2D6ULL,
+    0x5A110C6058B920A0ULL, 0x0CD9A497658A5698ULL, 0x56FD23C8F9715A4CULL, 0x284C847B9D887AAEULL,
+    0x04FEABFBBDB619CBULL, 0x742E1E651C60BA83ULL, 0x9A9632E65904AD3CULL, 0x881B82A13B51B9E2ULL,
+    0x506E6744CD974924ULL, 0xB0183DB56FFC6A79ULL, 0x0ED9B915C66ED37EULL, 0x5E11E86D5873D484ULL,
+    0xF678647E3519AC6EULL, 0x1B85D488D0F20CC5ULL, 0xDAB9FE6525D89021ULL, 0x0D151D86ADB73615ULL,
+    0xA865A54EDCC0F019ULL, 0x93C42566AEF98FFBULL, 0x99E7AFEABE000731ULL, 0x48CBFF086DDF285AULL,
+    0x7F9B6AF1EBF78BAFULL, 0x58627E1A149BBA21ULL, 0x2CD16E2ABD791E33ULL, 0xD363EFF5F0977996ULL,
+    0x0CE2A38C344A6EEDULL, 0x1A804AADB9CFA741ULL, 0x907F30421D78C5DEULL, 0x501F65EDB3034D07ULL,
+    0x37624AE5A48FA6E9ULL, 0x957BAF61700CFF4EULL, 0x3A6C27934E31188AULL, 0xD49503536ABCA345ULL,
+    0x088E049589C432E0ULL, 0xF943AEE7FEBF21B8ULL, 0x6C3B8E3E336139D3ULL, 0x364F6FFA464EE52EULL,
+    0xD60F6DCEDC314222ULL, 0x56963B0DCA418FC0ULL, 0x16F50EDF91E513AFULL, 0xEF1955914B609F93ULL,
+    0x565601C0364E3228ULL, 0xECB53939887E8175ULL, 0xBAC7A9A18531294BULL, 0xB344C470397BBA52ULL,
+    0x65D34954DAF3CEBDULL, 0xB4B81B3FA97511E2ULL, 0xB422061193D6F6A7ULL, 0x071582401C38434DULL,
+    0x7A13F18BBEDC4FF5ULL, 0xBC4097B116C524D2ULL, 0x59B97885E2F2EA28ULL, 0x99170A5DC3115544ULL,
+    0x6F423357E7C6A9F9ULL, 0x325928EE6E6F8794ULL, 0xD0E4366228B03343ULL, 0x565C31F7DE89EA27ULL,
+    0x30F5611484119414ULL, 0xD873DB391292ED4FULL, 0x7BD94E1D8E17DEBCULL, 0xC7D9F16864A76E94ULL,
+    0x947AE053EE56E63CULL, 0xC8C93882F9475F5FULL, 0x3A9BF55BA91F81CAULL, 0xD9A11FBB3D9808E4ULL,
+    0x0FD22063EDC29FCAULL, 0xB3F256D8ACA0B0B9ULL, 0xB03031A8B4516E84ULL, 0x35DD37D5871448AFULL,
+    0xE9F6082B05542E4EULL, 0xEBFAFA33D7254B59ULL, 0x9255ABB50D532280ULL, 0xB9AB4CE57F2D34F3ULL,
+    0x693501D628297551ULL, 0xC62C58F97DD949BFULL, 0xCD454F8F19C5126AULL, 0xBBE83F4ECC2BDECBULL,
+    0xDC842B7E2819E230ULL, 0xBA89142E007503B8ULL, 0xA3BC941D0A5061CBULL, 0xE9F6760E32CD8021ULL,
+    0x09C7E552BC76492FULL, 0x852F54934DA55CC9ULL, 0x8107FCCF064FCF56ULL, 0x098954D51FFF6580ULL,
+    0x23B70EDB1955C4BFULL, 0xC330DE426430F69DULL, 0x4715ED43E8A45C0AULL, 0xA8D7E4DAB780A08DULL,
+    0x0572B974F03CE0BBULL, 0xB57D2E985E1419C7ULL, 0xE8D9ECBE2CF3D73FULL, 0x2FE4B17170E59750ULL,
+    0x11317BA87905E790ULL, 0x7FBF21EC8A1F45ECULL, 0x1725CABFCB045B00ULL, 0x964E915CD5E2B207ULL,
+    0x3E2B8BCBF016D66DULL, 0xBE7444E39328A0ACULL, 0xF85B2B4FBCDE44B7ULL, 0x49353FEA39BA63B1ULL,
+    0x1DD01AAFCD53486AULL, 0x1FCA8A92FD719F85ULL, 0xFC7C95D827357AFAULL, 0x18A6A990C8B35EBDULL,
+    0xCCCB7005C6B9C28DULL, 0x3BDBB92C43B17F26ULL, 0xAA70B5B4F89695A2ULL, 0xE94C39A54A98307FULL,
+    0xB7A0B174CFF6F36EULL, 0xD4DBA84729AF48ADULL, 0x2E18BC1AD9704A68ULL, 0x2DE0966DAF2F8B1CULL,
+    0xB9C11D5B1E43A07EULL, 0x64972D68DEE33360ULL, 0x94628D38D0C20584ULL, 0xDBC0D2B6AB90A559ULL,
+    0xD2733C4335C6A72FULL, 0x7E75D99D94A70F4DULL, 0x6CED1983376FA72BULL, 0x97FCAACBF030BC24ULL,
+    0x7B77497B32503B12ULL, 0x8547EDDFB81CCB94ULL, 0x79999CDFF70902CBULL, 0xCFFE1939438E9B24ULL,
+    0x829626E3892D95D7ULL, 0x92FAE24291F2B3F1ULL, 0x63E22C147B9C3403ULL, 0xC678B6D860284A1CULL,
+    0x5873888850659AE7ULL, 0x0981DCD296A8736DULL, 0x9F65789A6509A440ULL, 0x9FF38FED72E9052FULL,
+    0xE479EE5B9930578CULL, 0xE7F28ECD2D49EECDULL, 0x56C074A581EA17FEULL, 0x5544F7D774B14AEFULL,
+    0x7B3F0195FC6F290FULL, 0x12153635B2C0CF57ULL, 0x7F5126DBBA5E0CA7ULL, 0x7A76956C3EAFB413ULL,
+    0x3D5774A11D31AB39ULL, 0x8A1B083821F40CB4ULL, 0x7B4A38E32537DF62ULL, 0x950113646D1D6E03ULL,
+    0x4DA8979A0041E8A9ULL, 0x3BC36E078F7515D7ULL, 0x5D0A12F27AD310D1ULL, 0x7F9D1A2E1EBE1327ULL,
+    0xDA3A361B1C5157B1ULL, 0xDCDD7D20903D0C25ULL, 0x36833336D068F707ULL, 0xCE68341F79893389ULL,
+    0xAB9090168DD05F34ULL, 0x43954B3252DC25E5ULL, 0xB438C2B67F98E5E9ULL, 0x10DCD78E3851A492ULL,
+    0xDBC27AB5447822BFULL, 0x9B3CDB65F82CA382ULL, 0xB67B7896167B4C84ULL, 0xBFCED1B0048EAC50ULL,
+    0xA9119B60369FFEBDULL, 0x1FFF7AC80904BF45ULL, 0xAC12FB171817EEE7ULL, 0xAF08DA9177DDA93DULL,
+    0x1B0CAB936E65C744ULL, 0xB559EB1D04E5E932ULL, 0xC37B45B3F8D6F2BAULL, 0xC3A9DC228CAAC9E9ULL,
+    0xF3B8B6675A6507FFULL, 0x9FC477DE4ED681DAULL, 0x67378D8ECCEF96CBULL, 0x6DD856D94D259236ULL,
+    0xA319CE15B0B4DB31ULL, 0x073973751F12DD5EULL, 0x8A8E849EB32781A5ULL, 0xE1925C71285279F5ULL,
+    0x74C04BF1790C0EFEULL, 0x4DDA48153C94938AULL, 0x9D266D6A1CC0542CULL, 0x7440FB816508C4FEULL,
+    0x13328503DF48229FULL, 0xD6BF7BAEE43CAC40ULL, 0x4838D65F6EF6748FULL, 0x1E152328F3318DEAULL,
+    0x8F8419A348F296BFULL, 0x72C8834A5957B511ULL, 0xD7A023A73260B45CULL, 0x94EBC8ABCFB56DAEULL,
+    0x9FC10D0F989993E0ULL, 0xDE68A2355B93CAE6ULL, 0xA44CFE79AE538BBEULL, 0x9D1D84FCCE371425ULL,
+    0x51D2B1AB2DDFB636ULL, 0x2FD7E4B9E72CD38CULL, 0x65CA5B96B7552210ULL, 0xDD69A0D8AB3B546DULL,
+    0x604D51B25FBF70E2ULL, 0x73AA8A564FB7AC9EULL, 0x1A8C1E992B941148ULL, 0xAAC40A2703D9BEA0ULL,
+    0x764DBEAE7FA4F3A6ULL, 0x1E99B96E70A9BE8BULL, 0x2C5E9DEB57EF4743ULL, 0x3A938FEE32D29981ULL,
+    0x26E6DB8FFDF5ADFEULL, 0x469356C504EC9F9DULL, 0xC8763C5B08D1908CULL, 0x3F6C6AF859D80055ULL,
+    0x7F7CC39420A3A545ULL, 0x9BFB227EBDF4C5CEULL, 0x89039D79D6FC5C5CULL, 0x8FE88B57305E2AB6ULL,
+    0xA09E8C8C35AB96DEULL, 0xFA7E393983325753ULL, 0xD6B6D0ECC617C699ULL, 0xDFEA21EA9E7557E3ULL,
+    0xB67C1FA481680AF8ULL, 0xCA1E3785A9E724E5ULL, 0x1CFC8BED0D681639ULL, 0xD18D8549D140CAEAULL,
+    0x4ED0FE7E9DC91335ULL, 0xE4DBF0634473F5D2ULL, 0x1761F93A44D5AEFEULL, 0x53898E4C3910DA55ULL,
+    0x734DE8181F6EC39AULL, 0x2680B122BAA28D97ULL, 0x298AF231C85BAFABULL, 0x7983EED3740847D5ULL,
+    0x66C1A2A1A60CD889ULL, 0x9E17E49642A3E4C1ULL, 0xEDB454E7BADC0805ULL, 0x50B704CAB602C329ULL,
+    0x4CC317FB9CDDD023ULL, 0x66B4835D9EAFEA22ULL, 0x219B97E26FFC81BDULL, 0x261E4E4C0A333A9DULL,
+    0x1FE2CCA76517DB90ULL, 0xD7504DFA8816EDBBULL, 0xB9571FA04DC089C8ULL, 0x1DDC0325259B27DEULL,
+    0xCF3F4688801EB9AAULL, 0xF4F5D05C10CAB243ULL, 0x38B6525C21A42B0EULL, 0x36F60E2BA4FA6800ULL,
+    0xEB3593803173E0CEULL, 0x9C4CD6257C5A3603ULL, 0xAF0C317D32ADAA8AULL, 0x258E5A80C7204C4BULL,
+    0x8B889D624D44885DULL, 0xF4D14597E660F855ULL, 0xD4347F66EC8941C3ULL, 0xE699ED85B0DFB40DULL,
+    0x2472F6207C2D0484ULL, 0xC2A1E7B5B459AEB5ULL, 0xAB4F6451CC1D45ECULL, 0x63767572AE3D6174ULL,
+    0xA59E0BD101731A28ULL, 0x116D0016CB948F09ULL, 0x2CF9C8CA052F6E9FULL, 0x0B090A7560A968E3ULL,
+    0xABEEDDB2DDE06FF1ULL, 0x58EFC10B06A2068DULL, 0xC6E57A78FBD986E0ULL, 0x2EAB8CA63CE802D7ULL,
+    0x14A195640116F336ULL, 0x7C0828DD624EC390ULL, 0xD74BBE77E6116AC7ULL, 0x804456AF10F5FB53ULL,
+    0xEBE9EA2ADF4321C7ULL, 0x03219A39EE587A30ULL, 0x49787FEF17AF9924ULL, 0xA1E9300CD8520548ULL,
+    0x5B45E522E4B1B4EFULL, 0xB49C3B3995091A36ULL, 0xD4490AD526F14431ULL, 0x12A8F216AF9418C2ULL,
+    0x001F837CC7350524ULL, 0x1877B51E57A764D5ULL, 0xA2853B80F17F58EEULL, 0x993E1DE72D36D310ULL,
+    0xB3598080CE64A656ULL, 0x252F59CF0D9F04BBULL, 0xD23C8E176D113600ULL, 0x1BDA0492E7E4586EULL,
+    0x21E0BD5026C619BFULL, 0x3B097ADAF088F94EULL, 0x8D14DEDB30BE846EULL, 0xF95CFFA23AF5F6F4ULL,
+    0x3871700761B3F743ULL, 0xCA672B91E9E4FA16ULL, 0x64C8E531BFF53B55ULL, 0x241260ED4AD1E87DULL,
+    0x106C09B972D2E822ULL, 0x7FBA195410E5CA30ULL, 0x7884D9BC6CB569D8ULL, 0x0647DFEDCD894A29ULL,
+    0x63573FF03E224774ULL, 0x4FC8E9560F91B123ULL, 0x1DB956E450275779ULL, 0xB8D91274B9E9D4FBULL,
+    0xA2EBEE47E2FBFCE1ULL, 0xD9F1F30CCD97FB09ULL, 0xEFED53D75FD64E6BULL, 0x2E6D02C36017F67FULL,
+    0xA9AA4D20DB084E9BULL, 0xB64BE8D8B25396C1ULL, 0x70CB6AF7C2D5BCF0ULL, 0x98F076A4F7A2322EULL,
+    0xBF84470805E69B5FULL, 0x94C3251F06F90CF3ULL, 0x3E003E616A6591E9ULL, 0xB925A6CD0421AFF3ULL,
+    0x61BDD1307C66E300ULL, 0xBF8D5108E27E0D48ULL, 0x240AB57A8B888B20ULL, 0xFC87614BAF287E07ULL,
+    0xEF02CDD06FFDB432ULL, 0xA1082C0466DF6C0AULL, 0x8215E577001332C8ULL, 0xD39BB9C3A48DB6CFULL,
+    0x2738259634305C14ULL, 0x61CF4F94C97DF93DULL, 0x1B6BACA2AE4E125BULL, 0x758F450C88572E0BULL,
+    0x959F587D507A8359ULL, 0xB063E962E045F54DULL, 0x60E8ED72C0DFF5D1ULL, 0x7B64978555326F9FULL,
+    0xFD080D236DA814BAULL, 0x8C90FD9B083F4558ULL, 0x106F72FE81E2C590ULL, 0x7976033A39F7D952ULL,
+    0xA4EC0132764CA04BULL, 0x733EA705FAE4FA77ULL, 0xB4D8F77BC3E56167ULL, 0x9E21F4F903B33FD9ULL,
+    0x9D765E419FB69F6DULL, 0xD30C088BA61EA5EFULL, 0x5D94337FBFAF7F5BULL, 0x1A4E4822EB4D7A59ULL,
+    0x6FFE73E81B637FB3ULL, 0xDDF957BC36D8B9CAULL, 0x64D0E29EEA8838B3ULL, 0x08DD9BDFD96B9F63ULL,
+    0x087E79E5A57D1D13ULL, 0xE328E230E3E2B3FBULL, 0x1C2559E30F0946BEULL, 0x720BF5F26F4D2EAAULL,
+    0xB0774D261CC609DBULL, 0x443F64EC5A371195ULL, 0x4112CF68649A260EULL, 0xD813F2FAB7F5C5CAULL,
+    0x660D3257380841EEULL, 0x59AC2C7873F910A3ULL, 0xE846963877671A17ULL, 0x93B633ABFA3469F8ULL,
+    0xC0C0F5A60EF4CDCFULL, 0xCAF21ECD4377B28CULL, 0x57277707199B8175ULL, 0x506C11B9D90E8B1DULL,
+    0xD83CC2687A19255FULL, 0x4A29C6465A314CD1ULL, 0xED2DF21216235097ULL, 0xB5635C95FF7296E2ULL,
+    0x22AF003AB672E811ULL, 0x52E762596BF68235ULL, 0x9AEBA33AC6ECC6B0ULL, 0x944F6DE09134DFB6ULL,
+    0x6C47BEC883A7DE39ULL, 0x6AD047C430A12104ULL, 0xA5B1CFDBA0AB4067ULL, 0x7C45D833AFF07862ULL,
+    0x5092EF950A16DA0BULL, 0x9338E69C052B8E7BULL, 0x455A4B4CFE30E3F5ULL, 0x6B02E63195AD0CF8ULL,
+    0x6B17B224BAD6BF27ULL, 0xD1E0CCD25BB9C169ULL, 0xDE0C89A556B9AE70ULL, 0x50065E535A213CF6ULL,
+    0x9C1169FA2777B874ULL, 0x78EDEFD694AF1EEDULL, 0x6DC93D9526A50E68ULL, 0xEE97F453F06791EDULL,
+    0x32AB0EDB696703D3ULL, 0x3A6853C7E70757A7ULL, 0x31865CED6120F37DULL, 0x67FEF95D92607890ULL,
+    0x1F2B1D1F15F6DC9CULL, 0xB69E38A8965C6B65ULL, 0xAA9119FF184CCCF4ULL, 0xF43C732873F24C13ULL,
+    0xFB4A3D794A9A80D2ULL, 0x3550C2321FD6109CULL, 0x371F77E76BB8417EULL, 0x6BFA9AAE5EC05779ULL,
+    0xCD04F3FF001A4778ULL, 0xE3273522064480CAULL, 0x9F91508BFFCFC14AULL, 0x049A7F41061A9E60ULL,
+    0xFCB6BE43A9F2FE9BULL, 0x08DE8A1C7797DA9BULL, 0x8F9887E6078735A1ULL, 0xB5B4071DBFC73A66ULL,
+    0x230E343DFBA08D33ULL, 0x43ED7F5A0FAE657DULL, 0x3A88A0FBBCB05C63ULL, 0x21874B8B4D2DBC4FULL,
+    0x1BDEA12E35F6A8C9ULL, 0x53C065C6C8E63528ULL, 0xE34A1D250E7A8D6BULL, 0xD6B04D3B7651DD7EULL,
+    0x5E90277E7CB39E2DULL, 0x2C046F22062DC67DULL, 0xB10BB459132D0A26ULL, 0x3FA9DDFB67E2F199ULL,
+    0x0E09B88E1914F7AFULL, 0x10E8B35AF3EEAB37ULL, 0x9EEDECA8E272B933ULL, 0xD4C718BC4AE8AE5FULL,
+    0x81536D601170FC20ULL, 0x91B534F885818A06ULL, 0xEC8177F83F900978ULL, 0x190E714FADA5156EULL,
+    0xB592BF39B0364963ULL, 0x89C350C893AE7DC1ULL, 0xAC042E70F8B383F2ULL, 0xB49B52E587A1EE60ULL,
+    0xFB152FE3FF26DA89ULL, 0x3E666E6F69AE2C15ULL, 0x3B544EBE544C19F9ULL, 0xE805A1E290CF2456ULL,
+    0x24B33C9D7ED25117ULL, 0xE74733427B72F0C1ULL, 0x0A804D18B7097475ULL, 0x57E3306D881EDB4FULL,
+    0x4AE7D6A36EB5DBCBULL, 0x2D8D5432157064C8ULL, 0xD1E649DE1E7F268BULL, 0x8A328A1CEDFE552CULL,
+    0x07A3AEC79624C7DAULL, 0x84547DDC3E203C94ULL, 0x990A98FD5071D263ULL, 0x1A4FF12616EEFC89ULL,
+    0xF6F7FD1431714200ULL, 0x30C05B1BA332F41CULL, 0x8D2636B81555A786ULL, 0x46C9FEB55D120902ULL,
+    0xCCEC0A73B49C9921ULL, 0x4E9D2827355FC492ULL, 0x19EBB029435DCB0FULL, 0x4659D2B743848A2CULL,
+    0x963EF2C96B33BE31ULL, 0x74F85198B05A2E7DULL, 0x5A0F544DD2B1FB18ULL, 0x03727073C2E134B1ULL,
+    0xC7F6AA2DE59AEA61ULL, 0x352787BAA0D7C22FULL, 0x9853EAB63B5E0B35ULL, 0xABBDCDD7ED5C0860ULL,
+    0xCF05DAF5AC8D77B0ULL, 0x49CAD48CEBF4A71EULL, 0x7A4C10EC2158C4A6ULL, 0xD9E92AA246BF719EULL,
+    0x13AE978D09FE5557ULL, 0x730499AF921549FFULL, 0x4E4B705B92903BA4ULL, 0xFF577222C14F0A3AULL,
+    0x55B6344CF97AAFAEULL, 0xB862225B055B6960ULL, 0xCAC09AFBDDD2CDB4ULL, 0xDAF8E9829FE96B5FULL,
+    0xB5FDFC5D3132C498ULL, 0x310CB380DB6F7503ULL, 0xE87FBB46217A360EULL, 0x2102AE466EBB1148ULL,
+    0xF8549E1A3AA5E00DULL, 0x07A69AFDCC42261AULL, 0xC4C118BFE78FEAAEULL, 0xF9F4892ED96BD438ULL,
+    0x1AF3DBE25D8F45DAULL, 0xF5B4B0B0D2DEEEB4ULL, 0x962ACEEFA82E1C84ULL, 0x046E3ECAAF453CE9ULL,
+    0xF05D129681949A4CULL, 0x964781CE734B3C84ULL, 0x9C2ED44081CE5FBDULL, 0x522E23F3925E319EULL,
+    0x177E00F9FC32F791ULL, 0x2BC60A63A6F3B3F2ULL, 0x222BBFAE61725606ULL, 0x486289DDCC3D6780ULL,
+    0x7DC7785B8EFDFC80ULL, 0x8AF38731C02BA980ULL, 0x1FAB64EA29A2DDF7ULL, 0xE4D9429322CD065AULL,
+    0x9DA058C67844F20CULL, 0x24C0E332B70019B0ULL, 0x233003B5A6CFE6ADULL, 0xD586BD01C5C217F6ULL,
+    0x5E5637885F29BC2BULL, 0x7EBA726D8C94094BULL, 0x0A56A5F0BFE39272ULL, 0xD79476A84EE20D06ULL,
+    0x9E4C1269BAA4BF37ULL, 0x17EFEE45B0DEE640ULL, 0x1D95B0A5FCF90BC6ULL, 0x93CBE0B699C2585DULL,
+    0x65FA4F227A2B6D79ULL, 0xD5F9E858292504D5ULL, 0xC2B5A03F71471A6FULL, 0x59300222B4561E00ULL,
+    0xCE2F8642CA0712DCULL, 0x7CA9723FBB2E8988ULL, 0x2785338347F2BA08ULL, 0xC61BB3A141E50E8CULL,
+    0x150F361DAB9DEC26ULL, 0x9F6A419D382595F4ULL, 0x64A53DC924FE7AC9ULL, 0x142DE49FFF7A7C3DULL,
+    0x0C335248857FA9E7ULL, 0x0A9C32D5EAE45305ULL, 0xE6C42178C4BBB92EULL, 0x71F1CE2490D20B07ULL,
+    0xF1BCC3D275AFE51AULL, 0xE728E8C83C334074ULL, 0x96FBF83A12884624ULL, 0x81A1549FD6573DA5ULL,
+    0x5FA7867CAF35E149ULL, 0x56986E2EF3ED091BULL, 0x917F1DD5F8886C61ULL, 0xD20D8C88C8FFE65FULL,
+    0x31D71DCE64B2C310ULL, 0xF165B587DF898190ULL, 0xA57E6339DD2CF3A0ULL, 0x1EF6E6DBB1961EC9ULL,
+    0x70CC73D90BC26E24ULL, 0xE21A6B35DF0C3AD7ULL, 0x003A93D8B2806962ULL, 0x1C99DED33CB890A1ULL,
+    0xCF3145DE0ADD4289ULL, 0xD0E4427A5514FB72ULL, 0x77C621CC9FB3A483ULL, 0x67A34DAC4356550BULL,
+    0xF8D626AAAF278509ULL
+};
+
+// offsets of castling, enpassant & side keys in polyglot random table
+#define polyglot_castle 768
+#define polyglot_enpassant 772
+#define polyglot_side 780
+
+// polyglot piece kinds (black pawn = 0, white pawn = 1, ..., white king = 11)
+int polyglot_pieces[13] = {0, 1, 3, 5, 7, 9, 11, 0, 2, 4, 6, 8, 10};
+
+// book entry size in bytes
+#define book_entry_size 16
+
+// memory mapped book file
+unsigned char *book_data = NULL;
+
+// book size in bytes
+size_t book_size = 0;
+
+// number of book entries
+size_t book_entries = 0;
+
+// use book moves ("Book" UCI option)
+int use_book = 0;
+
+// book file name ("BookFile" UCI option)
+char book_file[256] = "book.bin";
+
+// generate polyglot hash key of the current position
+unsigned long long generate_polyglot_key()
+{
+    // final polyglot key
+    unsigned long long final_key = 0ULL;
+    
+    // loop over board squares
+    for (int square = 0; square < 128; square++)
+    {
+        // if square is on board and is occupied
+        if (!(square & 0x88) && board[square])
+        {
+            // polyglot square (a1 = 0, h8 = 63)
+            int polyglot_square = (7 - (square >> 4)) * 8 + (square & 7);
+            
+            // hash piece
+            final_key ^= polyglot_random[64 * polyglot_pieces[board[square]] + polyglot_square];
+        }
+    }
+    
+    // hash castling rights (KC, QC, kc, qc bits follow polyglot order)
+    for (int right = 0; right < 4; right++)
+        if (castle & (1 << right))
+            final_key ^= polyglot_random[polyglot_castle + right];
+    
+    // hash enpassant only if side to move has a pawn to capture it
+    if (enpassant != no_sq)
+    {
+        // squares of pawns that could capture enpassant
+        int capturer = (side == white) ? enpassant + 16 : enpassant - 16;
+        int pawn = (side == white) ? P : p;
+        
+        // on either side of the pawn that has just pushed
+        if ((!((capturer - 1) & 0x88) && board[capturer - 1] == pawn) ||
+            (!((capturer + 1) & 0x88) && board[capturer + 1] == pawn))
+            final_key ^= polyglot_random[polyglot_enpassant + (enpassant & 7)];
+    }
+    
+    // hash the side only if white is to move
+    if (side == white)
+        final_key ^= polyglot_random[polyglot_side];
+    
+    // return generated polyglot key
+    return final_key;
+}
+
+// read big endian number from book data
+static inline unsigned long long read_book_number(unsigned char *data, int bytes)
+{
+    // number to read
+    unsigned long long number = 0ULL;
+    
+    // most significant byte comes first
+    for (int index = 0; index < bytes; index++)
+        number = (number << 8) | data[index];
+    
+    return number;
+}
+
+// unmap current book
+void close_book()
+{
+    // no book is open
+    if (book_data == NULL)
+        return;
+    
+    #ifdef WIN64
+        UnmapViewOfFile(book_data);
+    #else
+        munmap(book_data, book_size);
+    #endif
+    
+    // reset book
+    book_data = NULL;
+    book_size = 0;
+    book_entries = 0;
+}
+
+// memory map book file (returns 0 on failure)
+int open_book(char *file_name)
+{
+    // unmap previous book
+    close_book();
+    
+    #ifdef WIN64
+        // open book file
+        HANDLE file = CreateFileA(file_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        
+        if (file == INVALID_HANDLE_VALUE)
+            return 0;
+        
+        // get file size
+        LARGE_INTEGER file_size;
+        
+        if (GetFileSizeEx(file, &file_size) && file_size.QuadPart >= book_entry_size)
+        {
+            // map the whole file read only
+            HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            
+            if (mapping)
+            {
+                book_data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                book_size = (size_t)file_size.QuadPart;
+                
+                // the view keeps the mapping alive
+                CloseHandle(mapping);
+            }
+        }
+        
+        // the mapping keeps the file alive
+        CloseHandle(file);
+    #else
+        // open book file
+        int file = open(file_name, O_RDONLY);
+        
+        if (file == -1)
+            return 0;
+        
+        // get file size
+        struct stat file_stat;
+        
+        if (!fstat(file, &file_stat) && file_stat.st_size >= book_entry_size)
+        {
+            // map the whole file read only
+            void *data = mmap(NULL, file_stat.st_size, PROT_READ, MAP_SHARED, file, 0);
+            
+            if (data != MAP_FAILED)
+            {
+                book_data = data;
+                book_size = file_stat.st_size;
+                
+                // probes jump around the file
+                madvise(book_data, book_size, MADV_RANDOM);
+            }
+        }
+        
+        // the mapping keeps the file alive
+        close(file);
+    #endif
+    
+    // failed to map the file
+    if (book_data == NULL)
+    {
+        book_size = 0;
+        return 0;
+    }
+    
+    // trailing bytes of truncated file are ignored
+    book_entries = book_size / book_entry_size;
+    
+    // seed book move selection
+    srand((unsigned int)get_time_ms());
+    
+    return 1;
+}
+
+// convert polyglot move to engine move (returns 0 if move is not legal)
+static inline int parse_book_move(int book_move, moves *move_list)
+{
+    // parse source & target squares
+    int source = (7 - ((book_move >> 9) & 7)) * 16 + ((book_move >> 6) & 7);
+    int target = (7 - ((book_move >> 3) & 7)) * 16 + (book_move & 7);
+    
+    // parse promoted piece (1 = knight, ..., 4 = queen)
+    int promotion = (book_move >> 12) & 7;
+    
+    // castling is encoded as king captures own rook
+    if (board[source] == K || board[source] == k)
+    {
+        if (source == e1 && target == h1) target = g1;
+        else if (source == e1 && target == a1) target = c1;
+        else if (source == e8 && target == h8) target = g8;
+        else if (source == e8 && target == a8) target = c8;
+    }
+    
+    // loop over legal moves
+    for (int count = 0; count < move_list->count; count++)
+    {
+        // pick up move
+        int move = move_list->moves[count];
+        
+        // skip moves with different squares
+        if (get_move_source(move) != source || get_move_target(move) != target)
+            continue;
+        
+        // promoted piece type (N = 2, ..., Q = 5)
+        int promoted = get_move_piece(move);
+        
+        if (promoted > K)
+            promoted -= 6;
+        
+        // promoted piece must match as well
+        if ((promotion ? promotion + 1 : 0) == promoted)
+            return move;
+    }
+    
+    // move is not legal in current position
+    return 0;
+}
+
+// pick weighted random book move (returns 0 if position is not in book)
+int get_book_move()
+{
+    // no book is open
+    if (book_data == NULL)
+        return 0;
+    
+    // position to look up
+    unsigned long long key = generate_polyglot_key();
+    
+    // binary search for the first entry with the key
+    size_t low = 0, high = book_entries;
+    
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        
+        if (read_book_number(book_data + middle * book_entry_size, 8) < key)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    
+    // legal moves to validate book moves against
+    moves move_list[1];
+    generate_legal_moves(move_list);
+    
+    // book moves of the position & their weights
+    int book_moves[64], weights[64];
+    int move_count = 0, total_weight = 0;
+    
+    // loop over entries with the key
+    for (size_t entry = low; entry < book_entries && move_count < 64; entry++)
+    {
+        // pick up entry data
+        unsigned char *data = book_data + entry * book_entry_size;
+        
+        // no more entries of the position
+        if (read_book_number(data, 8) != key)
+            break;
+        
+        // convert book move
+        int move = parse_book_move((int)read_book_number(data + 8, 2), move_list);
+        int weight = (int)read_book_number(data + 10, 2);
+        
+        // skip illegal (key collision) & zero weight moves
+        if (move && weight)
+        {
+            book_moves[move_count] = move;
+            weights[move_count++] = weight;
+            total_weight += weight;
+        }
+    }
+    
+    // position is not in book
+    if (!move_count)
+        return 0;
+    
+    // pick move with probability proportional to its weight
+    int pick = rand() % total_weight;
+    
+    for (int count = 0; count < move_count; count++)
+    {
+        if (pick < weights[count])
+            return book_moves[count];
+        
+        pick -= weights[count];
+    }
+    
+    return book_moves[0];
+}
+
+
+/***********************************************\
+
+              UCI PROTOCOL FUNCTIONS
 
 \***********************************************/
 
-// count nodes
-long nodes = 0;
+// parse move (from UCI)
+int parse_move(char *move_str)
+{
+    // init move list
+	moves move_list[1];
+	
+	// generate moves
+	generate_moves(move_list);
+
+    // parse move string
+	int parse_from = (move_str[0] - 'a') + (8 - (move_str[1] - '0')) * 16;
+	int parse_to = (move_str[2] - 'a') + (8 - (move_str[3] - '0')) * 16;
+	int prom_piece = 0;
+    
+    // init move to encode
+	int move;
+	
+	// loop over generated moves
+	for(int count = 0; count < move_list->count; count++)
+	{
+	    // pick up move
+		move = move_list->moves[count];
+        
+        // if input move is present in the move list
+		if(get_move_source(move) == parse_from && get_move_target(move) == parse_to)
+		{
+		    // init promoted piece
+			prom_piece = get_move_piece(move);
+
+			// if promoted piece is present compare it with promoted piece from user input
+			if(prom_piece)
+			{
+				if((prom_piece == N || prom_piece == n) && move_str[4] == 'n')
+					return move;
+					
+				else if((prom_piece == B || prom_piece == b) && move_str[4] == 'b')
+					return move;
+					
+				else if((prom_piece == R || prom_piece == r) && move_str[4] == 'r')
+					return move;
+					
+				else if((prom_piece == Q || prom_piece == q) && move_str[4] == 'q')
+					return move;
+					
+				continue;
+			}
+            
+            // return move to make on board
+			return move;
+		}
+	}
+
+	// return illegal move
+	return 0;
+}
+
+// parse move in standard algebraic notation, e.g. "Nbd7", "exd8=Q+", "O-O" (returns 0 if illegal or ambiguous)
+int parse_san(char *san)
+{
+    // init legal moves
+    moves move_list[1];
+    generate_legal_moves(move_list);
+    
+    // castling (king's target file)
+    int castling_file = -1;
+    
+    if (!strncmp(san, "O-O-O", 5) || !strncmp(san, "0-0-0", 5))
+        castling_file = 2;
+    
+    else if (!strncmp(san, "O-O", 3) || !strncmp(san, "0-0", 3))
+        castling_file = 6;
+    
+    // find castling move
+    if (castling_file != -1)
+    {
+        for (int count = 0; count < move_list->count; count++)
+            if (get_move_castling(move_list->moves[count]) &&
+                (get_move_target(move_list->moves[count]) & 7) == castling_file)
+                return move_list->moves[count];
+        
+        return 0;
+    }
+    
+    // copy move letters & digits only (drop capture, check & annotation signs)
+    char text[16];
+    int length = 0;
+    
+    for (char *character = san; *character && *character != ' ' && *character != ';' && length < 15; character++)
+        if ((*character >= 'a' && *character <= 'z') || (*character >= 'A' && *character <= 'Z') ||
+            (*character >= '1' && *character <= '8'))
+            if (*character != 'x')
+                text[length++] = *character;
+    
+    text[length] = '\0';
+    
+    // moving piece type (P = 1, ..., K = 6)
+    char *piece_letters = " PNBRQK";
+    int piece = P, first = 0;
+    
+    if (length && strchr("NBRQK", text[0]))
+    {
+        piece = strchr(piece_letters, text[0]) - piece_letters;
+        first = 1;
+    }
+    
+    // promoted piece type
+    int promoted = 0;
+    
+    if (length && strchr("NBRQnbrq", text[length - 1]))
+    {
+        promoted = strchr(" PNBRQ", text[length - 1] & ~0x20) - " PNBRQ";
+        length--;
+    }
+    
+    // target square is mandatory
+    if (length - first < 2)
+        return 0;
+    
+    // parse target square
+    int target_file = text[length - 2] - 'a';
+    int target_rank = text[length - 1] - '1';
+    
+    if (target_file < 0 || target_file > 7 || target_rank < 0 || target_rank > 7)
+        return 0;
+    
+    int target = (7 - target_rank) * 16 + target_file;
+    
+    // parse source square disambiguation (file, rank or both)
+    int source_file = -1, source_rank = -1;
+    
+    for (int index = first; index < length - 2; index++)
+    {
+        if (text[index] >= 'a' && text[index] <= 'h')
+            source_file = text[index] - 'a';
+        
+        else if (text[index] >= '1' && text[index] <= '8')
+            source_rank = text[index] - '1';
+    }
+    
+    // matching move & number of matches
+    int found = 0, matches = 0;
+    
+    // loop over legal moves
+    for (int count = 0; count < move_list->count; count++)
+    {
+        int move = move_list->moves[count];
+        int source = get_move_source(move);
+        
+        // piece types of moving & promoted pieces
+        int move_piece = board[source] > K ? board[source] - 6 : board[source];
+        int move_promoted = get_move_piece(move) > K ? get_move_piece(move) - 6 : get_move_piece(move);
+        
+        // compare the move with parsed one
+        if (get_move_target(move) == target && move_piece == piece && move_promoted == promoted &&
+            (source_file == -1 || (source & 7) == source_file) &&
+            (source_rank == -1 || 7 - (source >> 4) == source_rank))
+        {
+            found = move;
+            matches++;
+        }
+    }
+    
+    // ambiguous moves are rejected
+    return matches == 1 ? found : 0;
+}
+
+// convert legal move to standard algebraic notation (san buffer needs 8 bytes at least)
+void move_to_san(int move, char *san)
+{
+    // parse move
+    int source = get_move_source(move);
+    int target = get_move_target(move);
+    int piece = board[source] > K ? board[source] - 6 : board[source];
+    int promoted = get_move_piece(move) > K ? get_move_piece(move) - 6 : get_move_piece(move);
+    
+    // init SAN length
+    int length = 0;
+    
+    // castling
+    if (get_move_castling(move))
+        length = sprintf(san, (target & 7) == 6 ? "O-O" : "O-O-O");
+    
+    else
+    {
+        // init legal moves
+        moves move_list[1];
+        generate_legal_moves(move_list);
+        
+        // piece letter & disambiguation
+        if (piece != P)
+        {
+            san[length++] = " PNBRQK"[piece];
+            
+            // other pieces of the same type reaching the target
+            int ambiguous = 0, same_file = 0, same_rank = 0;
+            
+            for (int count = 0; count < move_list->count; count++)
+            {
+                int other = get_move_source(move_list->moves[count]);
+                
+                if (other != source && get_move_target(move_list->moves[count]) == target && board[other] == board[source])
+                {
+                    ambiguous = 1;
+                    
+                    if ((other & 7) == (source & 7)) same_file = 1;
+                    if ((other >> 4) == (source >> 4)) same_rank = 1;
+                }
+            }
+            
+            // file is preferred, rank is used when file doesn't tell pieces apart
+            if (ambiguous && (!same_file || same_rank))
+                san[length++] = 'a' + (source & 7);
+            
+            if (ambiguous && same_file)
+                san[length++] = '8' - (source >> 4);
+        }
+        
+        // pawn captures start with source file
+        else if (get_move_capture(move))
+            san[length++] = 'a' + (source & 7);
+        
+        // capture sign
+        if (get_move_capture(move))
+            san[length++] = 'x';
+        
+        // target square
+        length += sprintf(san + length, "%s", square_to_coords[target]);
+        
+        // promoted piece
+        if (promoted)
+            length += sprintf(san + length, "=%c", " PNBRQK"[promoted]);
+    }
+    
+    // play move to find out whether it gives check or mate
+    play_move(move);
+    
+    if (is_square_attacked(king_square[side], side ^ 1))
+    {
+        // init replies
+        moves replies[1];
+        generate_legal_moves(replies);
+        
+        san[length++] = replies->count ? '+' : '#';
+    }
+    
+    unmake_move();
+    
+    san[length] = '\0';
+}
+
+// input buffer size
+#define inputBuffer (400 * 6)
+
+// search thread handle
+pthread_t search_handle;
+
+// is search thread running
+int searching = 0;
+
+// position to search (passed from UCI thread to search thread)
+board_state search_root;
+
+// depth limit of the search to run
+int search_depth = max_ply;
+
+// search thread entry point
+void *search_thread_main(void *arg)
+{
+    // no thread argument (position is passed in search_root)
+    (void)arg;
+    
+    // set up search thread's private board
+    restore_board_state(&search_root);
+    
+    // search position
+    search_position(search_depth);
+    
+    // free private pawn hash table
+    free_pawn_hash_table();
+    
+    return NULL;
+}
+
+// wait for running search to finish
+void wait_search()
+{
+    // join search thread
+    if (searching)
+        pthread_join(search_handle, NULL);
+    
+    // search thread is done
+    searching = 0;
+}
+
+// stop running search
+void stop_search_thread()
+{
+    // infinite search must end on "stop"
+    infinite_search = 0;
+    
+    // signal search threads to stop
+    stop_search = 1;
+    
+    // wait for bestmove to be printed
+    wait_search();
+}
+
+// parse "go" command
+void parse_go(char *line)
+{
+    // init parameters
+    int depth = -1, movestogo = 30, movetime = -1;
+    int time = -1, inc = 0;
+    
+    // init argument
+    char *argument = NULL;
+    
+    // infinite search
+    infinite_search = (strstr(line, "infinite") != NULL);
+    
+    // no nodes limit unless given
+    search_node_limit = 0;
+    
+    // match UCI "binc" command
+    if ((argument = strstr(line, "binc")) && side == black)
+        // parse black time increment
+        inc = atoi(argument + 5);
+    
+    // match UCI "winc" command
+    if ((argument = strstr(line, "winc")) && side == white)
+        // parse white time increment
+        inc = atoi(argument + 5);
+    
+    // match UCI "wtime" command
+    if ((argument = strstr(line, "wtime")) && side == white)
+        // parse white time limit
+        time = atoi(argument + 6);
+    
+    // match UCI "btime" command
+    if ((argument = strstr(line, "btime")) && side == black)
+        // parse black time limit
+        time = atoi(argument + 6);
+    
+    // match UCI "movestogo" command
+    if ((argument = strstr(line, "movestogo")))
+        // parse number of moves to go
+        movestogo = atoi(argument + 10);
+    
+    // match UCI "movetime" command
+    if ((argument = strstr(line, "movetime")))
+        // parse amount of time allowed to spend to make a move
+        movetime = atoi(argument + 9);
+    
+    // match UCI "depth" command
+    if ((argument = strstr(line, "depth")))
+        // parse search depth
+        depth = atoi(argument + 6);
+    
+    // match UCI "nodes" command
+    if ((argument = strstr(line, "nodes")))
+        // parse nodes limit
+        search_node_limit = atol(argument + 6) > 0 ? atol(argument + 6) : 1;
+    
+    // init start time
+    start_time = get_time_ms();
+    
+    // reset time control
+    time_set = 0;
+    
+    // fixed time per move
+    if (movetime != -1)
+    {
+        // spend the whole move time
+        time_set = 1;
+        stop_time = start_time + ((movetime > move_overhead) ? movetime - move_overhead : 1);
+        soft_stop_time = stop_time;
+    }
+    
+    // clock based time control
+    else if (time != -1)
+    {
+        // time we can afford to lose without flagging
+        int available = (time > move_overhead) ? time - move_overhead : 1;
+        
+        // avoid division by zero on bogus input
+        if (movestogo < 1)
+            movestogo = 1;
+        
+        // spend equal share of remaining time for every move plus most of the increment
+        int optimum = time / movestogo + inc * 3 / 4;
+        
+        // allow to exceed optimum time in the middle of an iteration
+        int maximum = optimum * 3;
+        
+        // never use more than available time
+        if (optimum > available) optimum = available;
+        if (maximum > available) maximum = available;
+        
+        // never spend more than a quarter of remaining time on a single move
+        if (maximum > available / 4 + inc && movestogo > 1)
+            maximum = available / 4 + inc > optimum ? available / 4 + inc : optimum;
+        
+        // set up time limits (iteration more than half the optimum won't likely finish in time)
+        time_set = 1;
+        soft_stop_time = start_time + optimum / 2;
+        stop_time = start_time + maximum;
+        
+        // print time allocation
+        printf("info string time %d inc %d movestogo %d optimum %d maximum %d\n",
+                time, inc, movestogo, optimum, maximum);
+    }
+    
+    // search until "stop" if no limits are given
+    if (depth == -1 && !time_set && !search_node_limit)
+        infinite_search = 1;
+    
+    // search as deep as possible if depth is not set
+    if (depth < 1 || depth > max_ply)
+        depth = max_ply;
+    
+    // play book move without searching (analysis has to search even in book)
+    if (use_book && !infinite_search)
+    {
+        // probe book
+        int book_move = get_book_move();
+
+        if (book_move)
+        {
+            // print book move
+            printf("info string book move\n");
+            printf("bestmove %s%s%s\n", square_to_coords[get_move_source(book_move)],
+                                        square_to_coords[get_move_target(book_move)],
+                                        promoted_pieces[get_move_piece(book_move)]);
+            
+            // no search uses the limits
+            clear_search_limits();
+
+            return;
+        }
+    }
+
+    // reset stop flag (here rather than in search thread so that early "stop" is not lost)
+    stop_search = 0;
+    
+    // pass position to search thread
+    save_board_state(&search_root);
+    search_depth = depth;
+    
+    // start search thread
+    searching = !pthread_create(&search_handle, NULL, search_thread_main, NULL);
+    
+    // no search thread: search on UCI thread (input is not read until the search ends)
+    if (!searching)
+        search_thread_main(NULL);
+}
+
+// print engine info
+void print_engine_info()
+{
+	printf("id name chess_0x88\n");
+	printf("id author Code Monkey King\n");
+	printf("option name Hash type spin default %d min 1 max %d\n", default_hash_size, max_hash_size);
+	printf("option name Threads type spin default 1 min 1 max %d\n", max_threads);
+	printf("option name NullMove type check default true\n");
+	printf("option name NullMoveReduction type spin default 2 min 1 max 4\n");
+	printf("option name Book type check default false\n");
+	printf("option name BookFile type string default book.bin\n");
+	printf("uciok\n");
+}
+
+// parse "setoption" command
+void parse_option(char *line)
+{
+    // parse "Hash" option
+    if (!strncmp(line, "setoption name Hash value ", 26))
+    {
+        // parse hash size in MB
+        int mb = atoi(line + 26);
+        
+        // clamp hash size
+        if (mb < 1) mb = 1;
+        if (mb > max_hash_size) mb = max_hash_size;
+        
+        // reallocate hash table
+        init_hash_table(mb);
+    }
+    
+    // parse "Threads" option
+    else if (!strncmp(line, "setoption name Threads value ", 29))
+    {
+        // parse number of threads
+        thread_count = atoi(line + 29);
+        
+        // clamp number of threads
+        if (thread_count < 1) thread_count = 1;
+        if (thread_count > max_threads) thread_count = max_threads;
+    }
+    
+    // parse "NullMove" option
+    else if (!strncmp(line, "setoption name NullMove value ", 30))
+        // enable or disable null move pruning
+        null_move_pruning = !strncmp(line + 30, "true", 4);
+    
+    // parse "NullMoveReduction" option
+    else if (!strncmp(line, "setoption name NullMoveReduction value ", 39))
+    {
+        // parse base reduction
+        null_move_reduction = atoi(line + 39);
+        
+        // clamp base reduction
+        if (null_move_reduction < 1) null_move_reduction = 1;
+        if (null_move_reduction > 4) null_move_reduction = 4;
+    }
+    
+    // parse "BookFile" option (before "Book" since they share the prefix)
+    else if (!strncmp(line, "setoption name BookFile value ", 30))
+    {
+        // copy file name without trailing new line
+        snprintf(book_file, sizeof(book_file), "%s", line + 30);
+        book_file[strcspn(book_file, "\r\n")] = 0;
+        
+        // map new book (it will be mapped on enabling otherwise)
+        if (use_book && !open_book(book_file))
+            printf("info string failed to open book %s\n", book_file);
+    }
+    
+    // parse "Book" option
+    else if (!strncmp(line, "setoption name Book value ", 26))
+    {
+        // enable or disable book
+        use_book = !strncmp(line + 26, "true", 4);
+        
+        // map book file on first use
+        if (use_book && book_data == NULL && !open_book(book_file))
+            printf("info string failed to open book %s\n", book_file);
+    }
+}
+
+/*
+    Bench: fixed depth single threaded search of built-in positions with
+    cleared hash table. Total nodes count doesn't depend on the machine, so
+    it serves as a signature of the search (any change in it means search
+    behaviour has changed), while time & NPS measure the speed
+*/
 
-int get_time_ms() {
-#ifdef WIN64
-	return GetTickCount ();
-#else
-	struct timeval t;
-	gettimeofday (&t, NULL);
-	return t.tv_sec*1000 + t.tv_usec/1000;
-#endif	
-}
+// default bench depth
+#define bench_depth 9
+
+// bench hash table size in MB (signature must not depend on "Hash" option)
+#define bench_hash_size 64
+
+// bench positions
+char *bench_positions[] = {
+    start_position,
+    tricky_position,
+    killer_position,
+    cmk_position,
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1 ",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1 ",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8 ",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10 ",
+    "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3 ",
+    "8/8/4k3/3p4/3P4/4K3/8/8 w - - 0 1 ",
+    "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1 ",
+    "2kr3r/ppp2ppp/2n5/2b1p3/4P1q1/2NP4/PPP2PPP/R2QKB1R w KQ - 0 10 "
+};
 
-// perft driver
-static inline void perft_driver(int depth)
+// search bench positions to given depth (returns total nodes, elapsed time goes to *time)
+long long run_bench(int depth, long long *time)
 {
-    // escape condition
-    if  (!depth)
+    // bench totals
+    long long total_nodes = 0;
+    long long bench_start = get_time_ms();
+    
+    #ifdef STATS
+        // null move pruning statistics of all positions
+        long null_move_tries = 0, null_move_cutoffs = 0;
+    #endif
+    
+    // number of bench positions
+    int position_count = sizeof(bench_positions) / sizeof(bench_positions[0]);
+    
+    // loop over bench positions
+    for (int count = 0; count < position_count; count++)
     {
-        // count current position
-        nodes++;
-        return;
+        printf("\n    Position %d/%d: %s\n\n", count + 1, position_count, bench_positions[count]);
+        
+        // set up position
+        parse_fen(bench_positions[count]);
+        
+        // search from scratch
+        clear_hash_table();
+        stop_search = 0;
+        
+        // search position (time in info output is per position)
+        start_time = get_time_ms();
+        search_position(depth);
+        
+        // update total nodes
+        total_nodes += nodes;
+        
+        #ifdef STATS
+            // update null move pruning statistics
+            null_move_tries += stats.null_move_tries;
+            null_move_cutoffs += stats.null_move_cutoffs;
+        #endif
     }
-
-    // create move list variable
-    moves move_list[1];
     
-    // generate moves
-    generate_moves(move_list);
+    // elapsed time
+    *time = get_time_ms() - bench_start;
     
-    // loop over the generated moves
-    for (int move_count = 0; move_count < move_list->count; move_count++)
+    // print results (backends generate moves in different order, so each has its own signature)
+    #ifdef BITBOARDS
+        printf("\n  Backend: bitboards");
+    #else
+        printf("\n  Backend: 0x88");
+    #endif
+    
+    printf("\n    Depth: %d", depth);
+    printf("\n    Nodes: %lld", total_nodes);
+    printf("\n     Time: %lld ms", *time);
+    printf("\n      NPS: %lld\n", total_nodes * 1000 / (*time ? *time : 1));
+    
+    // print null move pruning setup
+    if (null_move_pruning)
     {
-        // copy board state
-        copy_board();
-        
-        // make only legal moves
-        if (!make_move(move_list->moves[move_count], all_moves))
-            // skip illegal move
-            continue;
+        printf("\n    Null move: R = %d + depth / 6", null_move_reduction);
         
-        // recursive call
-        perft_driver(depth - 1);
+        #ifdef STATS
+            // tries & cutoffs are counted in statistics builds only
+            printf(", %ld tries, %ld cutoffs (%ld%%)", null_move_tries, null_move_cutoffs,
+                   null_move_tries ? null_move_cutoffs * 100 / null_move_tries : 0);
+        #endif
         
-        // restore board state
-        take_back();
+        printf("\n\n");
     }
+    
+    else
+        printf("\n    Null move: off\n\n");
+    
+    fflush(stdout);
+    
+    return total_nodes;
 }
 
-// perft test
-static inline void perft_test(int depth)
+// run bench (optionally once more without null move pruning to show its effect on time to depth)
+void bench(int depth, int null_move_compare)
 {
-    printf("\n    Performance test:\n\n");
+    // bench is always single threaded
+    int threads = thread_count;
+    thread_count = 1;
     
-    // init start time
-    int start_time = get_time_ms();
-
-    // create move list variable
-    moves move_list[1];
+    // keep current position
+    board_state position[1];
+    save_board_state(position);
     
-    // generate moves
-    generate_moves(move_list);
+    // keep current hash table (bench uses its own one of fixed size)
+    tt_bucket *table = hash_table;
+    unsigned long long mask = hash_mask;
+    size_t table_size = hash_table_size;
+    int age = hash_age;
     
-    // loop over the generated moves
-    for (int move_count = 0; move_count < move_list->count; move_count++)
+    hash_table = NULL;
+    init_hash_table(bench_hash_size);
+    
+    // run bench with current settings
+    long long time;
+    long long total_nodes = run_bench(depth, &time);
+    
+    // run bench without null move pruning & compare
+    if (null_move_compare && null_move_pruning)
     {
-        // copy board state
-        copy_board();
-        
-        // make only legal moves
-        if (!make_move(move_list->moves[move_count], all_moves))
-            // skip illegal move
-            continue;
+        null_move_pruning = 0;
         
-        // cummulative nodes
-        long cum_nodes = nodes;
+        long long plain_time;
+        long long plain_nodes = run_bench(depth, &plain_time);
         
-        // recursive call
-        perft_driver(depth - 1);
+        null_move_pruning = 1;
         
-        // old nodes
-        long old_nodes = nodes - cum_nodes;
+        printf("    Null move on:  nodes %lld, time %lld ms\n", total_nodes, time);
+        printf("    Null move off: nodes %lld, time %lld ms\n", plain_nodes, plain_time);
+        printf("    Null move saves %lld%% nodes, %lld%% time to depth %d\n\n",
+               plain_nodes ? 100 - total_nodes * 100 / plain_nodes : 0,
+               plain_time ? 100 - time * 100 / plain_time : 0, depth);
         
-        // restore board state
-        take_back();
-        
-        // print current move
-        printf("    move %d: %s%s%c    %ld\n",
-            move_count + 1,
-            square_to_coords[get_move_source(move_list->moves[move_count])],
-            square_to_coords[get_move_target(move_list->moves[move_count])],
-            promoted_pieces[get_move_piece(move_list->moves[move_count])],
-            old_nodes
-        );
+        fflush(stdout);
     }
     
-    // print results
-    printf("\n    Depth: %d", depth);
-    printf("\n    Nodes: %ld", nodes);
-    printf("\n     Time: %d ms\n\n", get_time_ms() - start_time);
+    // restore number of threads
+    thread_count = threads;
+    
+    // restore hash table
+    free_large_pages(hash_table);
+    hash_table = table;
+    hash_mask = mask;
+    hash_table_size = table_size;
+    hash_age = age;
+    
+    // restore position
+    restore_board_state(position);
 }
 
+/*
+    EPD solver: positions of a "bm" (best move) / "am" (avoid move) test
+    suite are searched in parallel, one position per worker thread. Each
+    worker has its own board & search heuristics (thread local) and stops
+    on its private time or nodes budget, only the hash table is shared.
+    A position counts as solved when the best move of the last finished
+    iteration is one of "bm" moves & none of "am" moves; time to solution
+    is the time since which the best move has stayed correct
+*/
 
-/***********************************************\
+// max number of EPD positions
+#define max_epd_positions 10000
 
-               EVALUATION FUNCTION
+// max number of "bm" / "am" moves per position
+#define max_epd_moves 8
 
-\***********************************************/
+// EPD suite position
+typedef struct {
+    // position's FEN (EPD has no move counters)
+    char fen[128];
+    
+    // "bm" & "am" operations (SAN moves)
+    char best_moves[128];
+    char avoid_moves[128];
+    
+    // "id" operation
+    char id[64];
+    
+    // results
+    int solved;
+    int best_move;
+    int score;
+    int depth;
+    long nodes;
+    long long solution_time;
+} epd_position;
 
-// evaluation of the position
-static inline int evaluate_position()
+// EPD suite shared between worker threads
+typedef struct {
+    // positions
+    epd_position *positions;
+    int count;
+    
+    // index of the next position to take
+    int next_position;
+    
+    // search budget per position (0 = no limit)
+    int time_limit;
+    long node_limit;
+} epd_suite;
+
+// parse SAN move list on current board (returns number of legal moves)
+static inline int parse_epd_moves(char *san_moves, int *move_list)
 {
-    // init score
-    int score = 0;
+    // number of parsed moves
+    int count = 0;
     
-    // loop over board squares
-    for (int square = 0; square < 128; square++)
+    // init SAN move & its length
+    char san[16];
+    int length;
+    
+    // loop over space separated moves
+    for (char *move = san_moves; count < max_epd_moves && sscanf(move, "%15s%n", san, &length) == 1; move += length)
+        if ((move_list[count] = parse_san(san)))
+            count++;
+    
+    return count;
+}
+
+// is the move one of listed moves
+static inline int is_listed_move(int move, int *move_list, int count)
+{
+    for (int index = 0; index < count; index++)
+        if (move_list[index] == move)
+            return 1;
+    
+    return 0;
+}
+
+// EPD solver worker thread
+void *epd_worker(void *suite_data)
+{
+    // init EPD suite
+    epd_suite *suite = suite_data;
+    
+    // take positions until none left
+    while (1)
     {
-        // make sure square is on board
-        if (!(square & 0x88))
+        // atomically take the next position
+        int index = __sync_fetch_and_add(&suite->next_position, 1);
+        
+        // no positions left
+        if (index >= suite->count)
+            break;
+        
+        // init current position
+        epd_position *position = &suite->positions[index];
+        
+        // set up private board
+        parse_fen(position->fen);
+        
+        // parse best moves & moves to avoid
+        int best_moves[max_epd_moves], avoid_moves[max_epd_moves];
+        int best_count = parse_epd_moves(position->best_moves, best_moves);
+        int avoid_count = parse_epd_moves(position->avoid_moves, avoid_moves);
+        
+        // init private nodes count, search heuristics & limits
+        nodes = 0;
+        clear_search_tables();
+        thread_stop = 0;
+        
+        long long start_time = get_time_ms();
+        thread_stop_time = suite->time_limit ? start_time + suite->time_limit : 0;
+        thread_node_limit = suite->node_limit;
+        
+        // time since the best move has been correct (-1 if it's wrong)
+        position->solution_time = -1;
+        
+        // iterative deepening until budget is spent
+        for (int current_depth = 1; current_depth < max_ply; current_depth++)
         {
-            // init piece
-            int piece = board[square];
+            // search position with current depth
+            int score = negamax_search(-50000, 50000, current_depth);
             
-            // material score evaluation
-            score += material_score[piece];
+            // unfinished iteration doesn't count
+            if (stop_search || thread_stop)
+                break;
             
-            // pieces evaluation
-			switch(piece)
-			{
-				// white pieces
-				case P: 
-				    // positional score
-				    score += pawn_score[square];
-				    
-				    // double panws penalty
-				    if (board[square - 16] == P)
-				        score -= 100;
-				    
-				    break;
-				        
-				case N: score += knight_score[square]; break;
-				case B: score += bishop_score[square]; break;
-				case R: score += rook_score[square]; break;
-				case K: score += king_score[square]; break;
-				
-				// black pieces
-				case p:
-				    // positional score
-				    score -= pawn_score[mirror_score[square]];
-				    
-				    // double pawns penalty
-				    if (board[square + 16] == p)
-				        score += 100;
-				        
-				    break;
-				case n: score -= knight_score[mirror_score[square]]; break;
-				case b: score -= bishop_score[mirror_score[square]]; break;
-				case r: score -= rook_score[mirror_score[square]]; break;
-				case k: score -= king_score[mirror_score[square]]; break;
-			}
+            // store iteration results
+            position->best_move = pv_table[0][0];
+            position->score = score;
+            position->depth = current_depth;
+            
+            // best move has become or stayed correct
+            if ((!position->best_moves[0] || is_listed_move(position->best_move, best_moves, best_count)) &&
+                !is_listed_move(position->best_move, avoid_moves, avoid_count))
+            {
+                if (position->solution_time == -1)
+                    position->solution_time = get_time_ms() - start_time;
+            }
+            
+            // best move is wrong
+            else
+                position->solution_time = -1;
+        }
+        
+        // store final results
+        position->solved = (position->solution_time != -1);
+        position->nodes = nodes;
+        
+        // print position results ("none" if no iteration has finished)
+        char move_string[8] = "none", score_string[32] = "none";
+        
+        if (position->best_move)
+        {
+            snprintf(move_string, sizeof(move_string), "%s%s%s", square_to_coords[get_move_source(position->best_move)],
+                     square_to_coords[get_move_target(position->best_move)], promoted_pieces[get_move_piece(position->best_move)]);
             
+            format_score(position->score, score_string);
         }
+        
+        printf("    %4d  %s  %-12s  move %-5s  score %-9s  depth %2d  nodes %10ld  time %6lld ms  %s%s%s%s\n",
+               index + 1, position->solved ? "solved" : "FAIL  ", position->id, move_string, score_string,
+               position->depth, position->nodes, position->solved ? position->solution_time : -1,
+               position->best_moves[0] ? "bm " : "", position->best_moves,
+               position->avoid_moves[0] ? (position->best_moves[0] ? " am " : "am ") : "", position->avoid_moves);
+        
+        fflush(stdout);
     }
-
-    // return positive score for white & negative for black
-    return !side ? score : -score;
+    
+    // reset private limits
+    thread_stop_time = 0;
+    thread_node_limit = 0;
+    
+    // free private pawn hash table
+    free_pawn_hash_table();
+    
+    return NULL;
 }
 
+// load EPD suite positions (returns number of positions)
+int load_epd_suite(char *file_name, epd_position *positions)
+{
+    // open EPD file
+    FILE *file = fopen(file_name, "r");
+    
+    // file not found
+    if (file == NULL)
+        return 0;
+    
+    // number of loaded positions
+    int count = 0;
+    
+    // init EPD line
+    char line[1024];
+    
+    // loop over EPD lines
+    while (count < max_epd_positions && fgets(line, sizeof(line), file))
+    {
+        // init current position
+        epd_position *position = &positions[count];
+        memset(position, 0, sizeof(epd_position));
+        
+        // parse FEN fields (board, side, castling, enpassant)
+        char pieces[96], side_to_move[4], castling[8], enpassant_square[4];
+        int offset = 0;
+        
+        if (sscanf(line, "%95s %3s %7s %3s %n", pieces, side_to_move, castling, enpassant_square, &offset) != 4 || !offset)
+            continue;
+        
+        // parse_fen needs a space after castling rights & enpassant square
+        snprintf(position->fen, sizeof(position->fen), "%s %s %s %s ", pieces, side_to_move, castling, enpassant_square);
+        
+        // loop over operations ("opcode operands;")
+        for (char *operation = strtok(line + offset, ";"); operation != NULL; operation = strtok(NULL, ";"))
+        {
+            // skip leading spaces
+            while (*operation == ' ')
+                operation++;
+            
+            // cut trailing new line
+            operation[strcspn(operation, "\r\n")] = '\0';
+            
+            // best moves
+            if (!strncmp(operation, "bm ", 3))
+                snprintf(position->best_moves, sizeof(position->best_moves), "%s", operation + 3);
+            
+            // moves to avoid
+            else if (!strncmp(operation, "am ", 3))
+                snprintf(position->avoid_moves, sizeof(position->avoid_moves), "%s", operation + 3);
+            
+            // position ID (without quotes)
+            else if (!strncmp(operation, "id ", 3))
+            {
+                char *id = operation + 3;
+                
+                if (*id == '"')
+                    id++;
+                
+                snprintf(position->id, sizeof(position->id), "%s", id);
+                position->id[strcspn(position->id, "\"")] = '\0';
+            }
+        }
+        
+        // positions with nothing to solve are skipped
+        if (position->best_moves[0] || position->avoid_moves[0])
+            count++;
+    }
+    
+    // close EPD file
+    fclose(file);
+    
+    return count;
+}
 
-/***********************************************\
-
-                 SEARCH FUNCTIONS
-
-\***********************************************/
-
-// most valuable victim & less valuable attacker
-
-/*
-                          
-    (Victims) Pawn Knight Bishop   Rook  Queen   King
-  (Attackers)
-        Pawn   105    205    305    405    505    605
-      Knight   104    204    304    404    504    604
-      Bishop   103    203    303    403    503    603
-        Rook   102    202    302    402    502    602
-       Queen   101    201    301    401    501    601
-        King   100    200    300    400    500    600
-
-*/
-
-static int mvv_lva[13][13] = {
-	0,   0,   0,   0,   0,   0,   0,  0,   0,   0,   0,   0,   0,
-	0, 105, 205, 305, 405, 505, 605,  105, 205, 305, 405, 505, 605,
-	0, 104, 204, 304, 404, 504, 604,  104, 204, 304, 404, 504, 604,
-	0, 103, 203, 303, 403, 503, 603,  103, 203, 303, 403, 503, 603,
-	0, 102, 202, 302, 402, 502, 602,  102, 202, 302, 402, 502, 602,
-	0, 101, 201, 301, 401, 501, 601,  101, 201, 301, 401, 501, 601,
-	0, 100, 200, 300, 400, 500, 600,  100, 200, 300, 400, 500, 600,
+// solve EPD suite with given number of threads & search budget per position
+void epd_solve(char *file_name, int thread_number, int time_limit, long node_limit)
+{
+    // init EPD suite
+    epd_suite suite[1];
+    suite->positions = malloc(max_epd_positions * sizeof(epd_position));
+    suite->count = load_epd_suite(file_name, suite->positions);
+    suite->next_position = 0;
+    suite->time_limit = time_limit;
+    suite->node_limit = node_limit;
+    
+    // nothing to solve
+    if (!suite->count)
+    {
+        printf("info string cannot load EPD suite %s\n", file_name);
+        free(suite->positions);
+        return;
+    }
+    
+    // clamp number of threads
+    if (thread_number < 1) thread_number = 1;
+    if (thread_number > max_threads) thread_number = max_threads;
+    
+    printf("\n    EPD suite: %s, %d positions, %d threads, ", file_name, suite->count, thread_number);
+    
+    if (time_limit) printf("%d ms ", time_limit);
+    if (node_limit) printf("%ld nodes ", node_limit);
+    
+    printf("per position\n\n");
+    fflush(stdout);
+    
+    // search from scratch (workers have private limits)
+    clear_hash_table();
+    stop_search = 0;
+    
+    long long start_time = get_time_ms();
+    
+    // run worker threads
+    run_worker_threads(epd_worker, suite, thread_number);
+    
+    // elapsed time
+    long long time = get_time_ms() - start_time;
+    
+    // suite totals
+    int solved = 0;
+    long long total_nodes = 0, solution_time = 0;
+    
+    for (int count = 0; count < suite->count; count++)
+    {
+        total_nodes += suite->positions[count].nodes;
+        
+        if (suite->positions[count].solved)
+        {
+            solved++;
+            solution_time += suite->positions[count].solution_time;
+        }
+    }
+    
+    // print suite totals
+    printf("\n    Solved: %d/%d", solved, suite->count);
+    printf("\n    Average time to solution: %lld ms", solved ? solution_time / solved : 0);
+    printf("\n     Nodes: %lld", total_nodes);
+    printf("\n      Time: %lld ms", time);
+    printf("\n       NPS: %lld\n\n", total_nodes * 1000 / (time ? time : 1));
+    
+    fflush(stdout);
+    
+    free(suite->positions);
+}
 
-	0, 105, 205, 305, 405, 505, 605,  105, 205, 305, 405, 505, 605,
-	0, 104, 204, 304, 404, 504, 604,  104, 204, 304, 404, 504, 604,
-	0, 103, 203, 303, 403, 503, 603,  103, 203, 303, 403, 503, 603,
-	0, 102, 202, 302, 402, 502, 602,  102, 202, 302, 402, 502, 602,
-	0, 101, 201, 301, 401, 501, 601,  101, 201, 301, 401, 501, 601,
-	0, 100, 200, 300, 400, 500, 600,  100, 200, 300, 400, 500, 600
-};
+/*
+    PGN annotator: games of a PGN file are replayed (SAN moves are parsed
+    on the game's board) and every position is searched to a fixed depth
+    or nodes budget. Games are read from the file one at a time by worker
+    threads, annotated games are written in the input order as soon as
+    all the preceding games are done.
+    
+    Every move gets "{score/depth}" comment (white's point of view, like
+    in engine games PGNs), moves other than the engine's choice are
+    followed by a variation with the best move & its score, and moves
+    losing 1 (3) pawns or more compared to the best move get "?" ("??")
+*/
 
-// killer moves [id][ply]
-int killer_moves[2][64];
+// max length of a PGN line
+#define pgn_line_size 4096
 
-// history moves [piece][square]
-int history_moves[13][128];
+// minimal score loss of mistakes & blunders
+#define mistake_margin 100
+#define blunder_margin 300
 
-// PV moves
-int pv_table[64][64];
-int pv_length[64];
+// growable text buffer
+typedef struct {
+    char *text;
+    size_t length;
+    size_t capacity;
+    
+    // length of the last line (movetext is wrapped at 80 columns)
+    int line_length;
+    
+    // out of memory (text is incomplete)
+    int failed;
+} pgn_buffer;
 
-// half move
-int ply = 0;
+// PGN game
+typedef struct {
+    // game number in the file
+    int number;
+    
+    // tag pairs & movetext as read from the file
+    pgn_buffer tags;
+    pgn_buffer movetext;
+    
+    // annotated game
+    pgn_buffer output;
+    
+    // number of annotated moves & nodes searched
+    int moves;
+    long nodes;
+} pgn_game;
 
-// score move for move ordering
-static inline int score_move(int move)
+// PGN annotator job shared between worker threads
+typedef struct {
+    // input file, line read ahead & file lock
+    FILE *input;
+    char pending_line[pgn_line_size];
+    int has_pending_line;
+    int next_number;
+    pthread_mutex_t input_lock;
+    
+    // output file, finished games waiting for their turn & output lock
+    FILE *output;
+    pgn_game **finished;
+    int finished_size;
+    int next_output;
+    pthread_mutex_t output_lock;
+    
+    // search limits per position (0 = no limit)
+    int depth;
+    long node_limit;
+    
+    // totals
+    int games;
+    int moves;
+    long long nodes;
+} pgn_job;
+
+// append text to buffer
+void pgn_append(pgn_buffer *buffer, char *text)
 {
-    // PV move
-    if (pv_table[0][ply] == move)
-        // score 20000 ( search it first )
-        return 20000;
- 
-    // init current move score
-    int score;
+    size_t length = strlen(text);
     
-    // score MVV LVA (scores 0 for quiete moves)
-    score = mvv_lva[board[get_move_source(move)]][board[get_move_target(move)]];         
+    // grow buffer
+    if (buffer->length + length + 1 > buffer->capacity)
+    {
+        char *text = realloc(buffer->text, (buffer->length + length + 1) * 2);
+        
+        // keep old text on allocation failure
+        if (text == NULL)
+        {
+            buffer->failed = 1;
+            return;
+        }
+        
+        buffer->text = text;
+        buffer->capacity = (buffer->length + length + 1) * 2;
+    }
+    
+    // copy text including terminating zero
+    memcpy(buffer->text + buffer->length, text, length + 1);
+    buffer->length += length;
+}
 
-    // on capture
-    if (get_move_capture(move))
+// append movetext token (separated by space or wrapped to the next line)
+void pgn_append_token(pgn_buffer *buffer, char *token)
+{
+    int length = strlen(token);
+    
+    // separate tokens
+    if (buffer->line_length && buffer->line_length + 1 + length > 79)
     {
-        // add 10000 to current score
-        score += 10000;
+        pgn_append(buffer, "\n");
+        buffer->line_length = 0;
     }
     
-    // on quiete move
-    else {
-        // on 1st killer move
-        if (killer_moves[0][ply] == move)
-            // score 9000
-            score = 9000;
-        
-        // on 2nd killer move
-        else if (killer_moves[1][ply] == move)
-            // score 8000
-            score = 8000;
-                      
-        // on history move (previous alpha's best score)
-        else
-            // score with history depth
-            score = history_moves[board[get_move_source(move)]][get_move_target(move)] + 7000;
+    else if (buffer->line_length)
+    {
+        pgn_append(buffer, " ");
+        buffer->line_length++;
     }
     
-    // return move score
-    return score;
+    pgn_append(buffer, token);
+    buffer->line_length += length;
 }
 
-static inline void sort_moves(moves *move_list)
+// read next game from PGN file (returns 0 at the end of file)
+int read_pgn_game(pgn_job *job, pgn_game *game)
 {
-    // define move scores array
-    int move_scores[move_list->count];
-    
-    // init move scores array
-    for (int count = 0; count < move_list->count; count++)
-        // score move
-        move_scores[count] = score_move(move_list->moves[count]);
+    // init line
+    char line[pgn_line_size];
     
-    // loop over current move score
-    for (int current = 0; current < move_list->count; current++)
+    // loop over lines
+    while (1)
     {
-        // loop over next move score
-        for (int next = current + 1; next < move_list->count; next++)
+        // take line read ahead or read a new one
+        if (job->has_pending_line)
         {
-            // order moves descending
-            if (move_scores[current] < move_scores[next])
+            strcpy(line, job->pending_line);
+            job->has_pending_line = 0;
+        }
+        
+        else if (!fgets(line, sizeof(line), job->input))
+            break;
+        
+        // tag pair
+        if (line[0] == '[')
+        {
+            // tag of the next game ends this one
+            if (game->movetext.length)
             {
-                // swap scores
-                int temp_score = move_scores[current];
-                move_scores[current] = move_scores[next];
-                move_scores[next] = temp_score;
-                
-                // swap corresponding moves
-                int temp_move = move_list->moves[current];
-                move_list->moves[current] = move_list->moves[next];
-                move_list->moves[next] = temp_move;
+                strcpy(job->pending_line, line);
+                job->has_pending_line = 1;
+                break;
             }
+            
+            pgn_append(&game->tags, line);
         }
-    }    
+        
+        // empty line ends movetext
+        else if (strspn(line, " \t\r\n") == strlen(line))
+        {
+            if (game->movetext.length)
+                break;
+        }
+        
+        // movetext
+        else
+            pgn_append(&game->movetext, line);
+    }
+    
+    // game has been read
+    return game->tags.length || game->movetext.length;
 }
 
-// quiescence search
-static inline int quiescence_search(int alpha, int beta, int depth)
+// find tag value (returns 0 if tag is missing)
+int get_pgn_tag(pgn_game *game, char *name, char *value, int size)
 {
-    // update nodes count
-    nodes++;
+    // init tag to look for
+    char tag[64];
+    snprintf(tag, sizeof(tag), "[%s \"", name);
     
-    // evaluate position
-    int eval = evaluate_position();
+    // find tag
+    char *start = game->tags.text ? strstr(game->tags.text, tag) : NULL;
     
-    //  fail hard beta-cutoff
-    if (eval >= beta)
-        return beta;
+    if (start == NULL)
+        return 0;
+    
+    // copy value up to closing quote
+    start += strlen(tag);
+    int length = strcspn(start, "\"");
+    
+    if (length > size - 1)
+        length = size - 1;
+    
+    memcpy(value, start, length);
+    value[length] = '\0';
+    
+    return 1;
+}
 
-    // alpha acts like max in MiniMax
-    if (eval > alpha)
-        alpha = eval;
+// search position on the thread's private board (returns score, best move is stored)
+static inline int search_annotated_position(pgn_job *job, int *best_move, int *best_depth)
+{
+    // init private search
+    nodes = 0;
+    clear_search_tables();
+    thread_stop = 0;
+    thread_node_limit = job->node_limit;
+    
+    // best score & move of the last finished iteration
+    int best_score = 0;
+    *best_move = 0;
+    *best_depth = 0;
+    
+    // iterative deepening
+    for (int current_depth = 1; current_depth <= job->depth; current_depth++)
+    {
+        // search position with current depth
+        int score = negamax_search(-50000, 50000, current_depth);
+        
+        // unfinished iteration doesn't count
+        if (stop_search || thread_stop)
+            break;
+        
+        // store iteration results
+        best_score = score;
+        *best_move = pv_table[0][0];
+        *best_depth = current_depth;
+    }
+    
+    // reset private limits
+    thread_node_limit = 0;
+    
+    return best_score;
+}
 
-    // create move list variable
-    moves move_list[1];
+// format score of given side from white's point of view in pawns (mates as "#N")
+void format_pgn_score(int score, int score_side, char *text)
+{
+    // white's point of view
+    if (score_side == black)
+        score = -score;
     
-    // generate moves
-    generate_moves(move_list);
+    // mate scores
+    if (score > mate_score)
+        sprintf(text, "#%d", (mate_value - score + 1) / 2);
     
-    // move ordering
-    sort_moves(move_list);
+    else if (score < -mate_score)
+        sprintf(text, "#-%d", (mate_value + score + 1) / 2);
     
-    // loop over the generated moves
-    for (int count = 0; count < move_list->count; count++)
-    {      
-        // copy board state
-        copy_board();
+    else
+        sprintf(text, "%+.2f", score / 100.0);
+}
+
+// annotate game
+void annotate_game(pgn_job *job, pgn_game *game)
+{
+    // set up initial position
+    char fen[256] = start_position;
+    
+    if (get_pgn_tag(game, "FEN", fen, sizeof(fen) - 1))
+        strcat(fen, " ");
+    
+    parse_fen(fen);
+    
+    // game result
+    char result[16] = "*";
+    get_pgn_tag(game, "Result", result, sizeof(result));
+    
+    // copy tags & add annotator
+    if (game->tags.length)
+        pgn_append(&game->output, game->tags.text);
+    
+    char annotator[128];
+    sprintf(annotator, "[Annotator \"Wukong %s %ld\"]\n\n", job->node_limit ? "nodes" : "depth",
+            job->node_limit ? job->node_limit : (long)job->depth);
+    pgn_append(&game->output, annotator);
+    
+    // search initial position
+    int best_move, best_depth;
+    int best_score = search_annotated_position(job, &best_move, &best_depth);
+    game->nodes += nodes;
+    
+    // init movetext parsing
+    char *text = game->movetext.text ? game->movetext.text : "";
+    
+    // full move number
+    int move_number = 1;
+    char *counters = strchr(fen, ' ');
+    
+    for (int fields = 0; counters != NULL && fields < 5; fields++)
+        counters = strchr(counters + 1, ' ');
+    
+    if (counters != NULL && atoi(counters + 1) > 0)
+        move_number = atoi(counters + 1);
+    
+    // loop over movetext
+    while (*text)
+    {
+        // skip spaces
+        if (strchr(" \t\r\n.", *text))
+        {
+            text++;
+            continue;
+        }
         
-        // increment ply
-        ply++;
+        // skip comments
+        if (*text == '{' || *text == ';')
+        {
+            text += strcspn(text, *text == '{' ? "}" : "\n");
+            
+            if (*text)
+                text++;
+            
+            continue;
+        }
         
-        // make only legal moves
-        if (!make_move(move_list->moves[count], only_captures))
+        // skip variations (including nested ones)
+        if (*text == '(')
         {
-            // decrement ply
-            ply--;
+            for (int level = 0; *text; text++)
+            {
+                if (*text == '(') level++;
+                if (*text == ')' && !--level) { text++; break; }
+            }
             
-            // skip illegal move
             continue;
         }
         
-        // recursive call
-        int score = -quiescence_search(-beta, -alpha, depth);
+        // read token
+        char token[64];
+        int length = strcspn(text, " \t\r\n{}();");
         
-        // restore board state
-        take_back();
+        if (length > 63)
+            length = 63;
         
-        // decrement ply
-        ply--;
+        memcpy(token, text, length);
+        token[length] = '\0';
+        text += length;
         
-        //  fail hard beta-cutoff
-        if (score >= beta)
-             return beta;
+        // skip NAGs
+        if (token[0] == '$')
+            continue;
         
-        // alpha acts like max in MiniMax
-        if (score > alpha)
-            alpha = score;
-    }
+        // game result ends movetext
+        if (!strcmp(token, "1-0") || !strcmp(token, "0-1") || !strcmp(token, "1/2-1/2") || !strcmp(token, "*"))
+        {
+            strcpy(result, token);
+            break;
+        }
         
-    // return alpha score
-    return alpha;
-}
-
-// negamax search
-static inline int negamax_search(int alpha, int beta, int depth)
-{       
-    // legal moves
-    int legal_moves = 0;
-    
-    // best move
-    int best_so_far = 0;
-    
-    // old alpha
-    int old_alpha = alpha;
+        // skip move number (the move may follow without space, e.g. "1.e4")
+        char *san = token + strspn(token, "0123456789");
+        
+        if (san != token && *san != '.')
+            san = token;
+        
+        san += strspn(san, ".");
+        
+        if (!*san)
+            continue;
+        
+        // parse played move
+        int move = parse_san(san);
+        
+        // stop annotating on illegal moves
+        if (!move)
+        {
+            char comment[96];
+            snprintf(comment, sizeof(comment), "{illegal move %s}", san);
+            pgn_append_token(&game->output, comment);
+            break;
+        }
+        
+        // played move & best move in SAN
+        char played_san[16], best_san[16], number[16];
+        move_to_san(move, played_san);
+        
+        if (best_move)
+            move_to_san(best_move, best_san);
+        
+        // best score in white's point of view
+        char best_text[16];
+        format_pgn_score(best_score, side, best_text);
+        
+        // move number
+        sprintf(number, side == white ? "%d." : "%d...", move_number);
+        
+        // side of the played move
+        int mover = side;
+        
+        // play move
+        make_move(move, all_moves);
+        
+        // search resulting position (score of the played move is the opponent's score negated)
+        int next_move, next_depth;
+        int next_score = search_annotated_position(job, &next_move, &next_depth);
+        game->nodes += nodes;
+        
+        // played move's score (mate distance is counted from the position before the move)
+        int played_score = -next_score;
+        
+        if (played_score > mate_score) played_score--;
+        if (played_score < -mate_score) played_score++;
+        
+        // score loss compared to the best move (mover's point of view)
+        int loss = best_move && best_move != move ? best_score - played_score : 0;
+        
+        // print move number & move with mistake mark as a single token
+        // (black's moves follow comments, so they need a number too)
+        char move_text[48];
+        sprintf(move_text, "%s %s%s", number, played_san,
+                loss >= blunder_margin ? "??" : loss >= mistake_margin ? "?" : "");
+        
+        pgn_append_token(&game->output, move_text);
+        
+        // print played move's score
+        char comment[64], played_text[16];
+        format_pgn_score(played_score, mover, played_text);
+        
+        sprintf(comment, "{%s/%d}", played_text, next_depth ? next_depth : best_depth);
+        pgn_append_token(&game->output, comment);
+        
+        // print best move as variation
+        if (best_move && best_move != move)
+        {
+            char variation[64];
+            sprintf(variation, "(%s %s {%s/%d})", number, best_san, best_text, best_depth);
+            pgn_append_token(&game->output, variation);
+        }
+        
+        // next full move
+        if (mover == black)
+            move_number++;
+        
+        // next position's search is the next move's best move
+        best_move = next_move;
+        best_score = next_score;
+        best_depth = next_depth;
+        game->moves++;
+    }
     
-    // PV length
-    pv_length[ply] = ply;
-
-    // escape condition
-    if  (!depth)
-        // search for calm position before evaluation
-        return quiescence_search(alpha, beta, depth);
+    // print result
+    pgn_append_token(&game->output, result);
+    pgn_append(&game->output, "\n\n");
+}
 
-    // update nodes count
-    nodes++;
-    
-    // is king in check?
-    int in_check = is_square_attacked(king_square[side], side ^ 1);
-    
-    // increase depth if king is in check
-    if (in_check)
-        depth++;
+// write annotated game & free it (called under output lock)
+void write_pgn_game(pgn_job *job, pgn_game *game)
+{
+    // incomplete game text
+    if (game->tags.failed || game->movetext.failed || game->output.failed)
+        printf("info string out of memory, game %d skipped\n", game->number + 1);
     
-    // create move list variable
-    moves move_list[1];
+    else
+    {
+        fputs(game->output.text, job->output);
+        fflush(job->output);
+    }
     
-    // generate moves
-    generate_moves(move_list);
+    // update totals
+    job->games++;
+    job->moves += game->moves;
+    job->nodes += game->nodes;
     
-    // move ordering
-    sort_moves(move_list);
+    // free game
+    free(game->tags.text);
+    free(game->movetext.text);
+    free(game->output.text);
+    free(game);
+}
+
+// write finished games in the input order (all remaining ones if flushing after the last game)
+void write_finished_games(pgn_job *job, int flush)
+{
+    while (job->next_output < job->finished_size && (flush || job->finished[job->next_output]))
+    {
+        // write game if it's there (games written out of order leave a gap)
+        if (job->finished[job->next_output])
+            write_pgn_game(job, job->finished[job->next_output]);
+        
+        job->finished[job->next_output++] = NULL;
+    }
+}
+
+// PGN annotator worker thread
+void *pgn_worker(void *job_data)
+{
+    // init PGN job
+    pgn_job *job = job_data;
     
-    // loop over the generated moves
-    for (int count = 0; count < move_list->count; count++)
+    // take games until none left
+    while (1)
     {
-        // copy board state
-        copy_board();
+        // init game
+        pgn_game *game = calloc(1, sizeof(pgn_game));
         
-        // increment ply
-        ply++;
+        // out of memory (other workers take the remaining games)
+        if (game == NULL)
+        {
+            printf("info string out of memory, PGN worker stopped\n");
+            break;
+        }
         
-        // make only legal moves
-        if (!make_move(move_list->moves[count], all_moves))
+        // read next game
+        pthread_mutex_lock(&job->input_lock);
+        int found = read_pgn_game(job, game);
+        game->number = job->next_number++;
+        pthread_mutex_unlock(&job->input_lock);
+        
+        // no games left
+        if (!found)
         {
-            // decrement ply
-            ply--;
-            
-            // skip illegal move
-            continue;
+            free(game);
+            break;
         }
-         
-        // increment legal moves
-        legal_moves++;
         
-        // recursive call
-        int score = -negamax_search(-beta, -alpha, depth - 1);
+        // annotate game
+        annotate_game(job, game);
         
-        // restore board state
-        take_back();
+        // store finished game
+        pthread_mutex_lock(&job->output_lock);
         
-        // decrement ply
-        ply--;
-
-        //  fail hard beta-cutoff
-        if (score >= beta)
+        // grow finished games array
+        if (game->number >= job->finished_size)
         {
-            // update killer moves
-            killer_moves[1][ply] = killer_moves[0][ply];
-            killer_moves[0][ply] = move_list->moves[count];
+            int size = (game->number + 1) * 2;
+            pgn_game **finished = realloc(job->finished, size * sizeof(pgn_game *));
             
-            return beta;
+            if (finished != NULL)
+            {
+                memset(finished + job->finished_size, 0, (size - job->finished_size) * sizeof(pgn_game *));
+                job->finished = finished;
+                job->finished_size = size;
+            }
         }
         
-        // alpha acts like max in MiniMax
-        if (score > alpha)
+        // keep game until its turn comes
+        if (game->number < job->finished_size)
+            job->finished[game->number] = game;
+        
+        // no memory to wait: write game out of order (later games are flushed at the end)
+        else
         {
-            // update history score
-            history_moves[board[get_move_source(move_list->moves[count])]][get_move_target(move_list->moves[count])] += depth;
+            printf("info string out of memory, game %d written out of order\n", game->number + 1);
+            write_pgn_game(job, game);
+        }
+        
+        // write finished games in the input order
+        write_finished_games(job, 0);
+        
+        pthread_mutex_unlock(&job->output_lock);
+    }
+    
+    // free private pawn hash table
+    free_pawn_hash_table();
+    
+    return NULL;
+}
 
-            // set alpha score
-            alpha = score;
-            
-            // store PV move
-			pv_table[ply][ply] = move_list->moves[count];
-			
-			for (int i = ply + 1; i < pv_length[ply + 1]; i++)
-				pv_table[ply][i] = pv_table[ply + 1][i];
-	
-			pv_length[ply] = pv_length[ply + 1];
-            
-            // store current best move
-            if(!ply)
-                best_so_far = move_list->moves[count];
-        }      
+// annotate PGN file with given number of threads & search limits per position
+void pgn_annotate(char *input_name, char *output_name, int thread_number, int depth, long node_limit)
+{
+    // init PGN job
+    pgn_job job[1];
+    memset(job, 0, sizeof(pgn_job));
+    
+    // open input file
+    job->input = fopen(input_name, "r");
+    
+    if (job->input == NULL)
+    {
+        printf("info string cannot open PGN file %s\n", input_name);
+        return;
     }
     
-    // if no legal moves
-    if (!legal_moves)
+    // open output file (annotated games go to stdout if not given)
+    job->output = output_name[0] ? fopen(output_name, "w") : stdout;
+    
+    if (job->output == NULL)
     {
-        // check mate detection
-        if (in_check)
-            return -49000 + ply;
-        
-        // stalemate detection
-        else
-            return 0;
+        printf("info string cannot create PGN file %s\n", output_name);
+        fclose(job->input);
+        return;
     }
     
-    // return alpha score
-    return alpha;
+    // init search limits
+    job->depth = depth;
+    job->node_limit = node_limit;
+    
+    // clamp number of threads
+    if (thread_number < 1) thread_number = 1;
+    if (thread_number > max_threads) thread_number = max_threads;
+    
+    // init locks
+    pthread_mutex_init(&job->input_lock, NULL);
+    pthread_mutex_init(&job->output_lock, NULL);
+    
+    // search from scratch (workers have private limits)
+    clear_hash_table();
+    stop_search = 0;
+    
+    long long start_time = get_time_ms();
+    
+    // run worker threads
+    run_worker_threads(pgn_worker, job, thread_number);
+    
+    // write games held back by a game written out of order
+    write_finished_games(job, 1);
+    
+    // elapsed time
+    long long time = get_time_ms() - start_time;
+    
+    // close files
+    fclose(job->input);
+    
+    if (job->output != stdout)
+        fclose(job->output);
+    
+    pthread_mutex_destroy(&job->input_lock);
+    pthread_mutex_destroy(&job->output_lock);
+    free(job->finished);
+    
+    // print totals
+    printf("\n    PGN file: %s, %d threads, %s %ld per position\n", input_name, thread_number,
+           node_limit ? "nodes" : "depth", node_limit ? node_limit : (long)depth);
+    printf("\n     Games: %d", job->games);
+    printf("\n     Moves: %d", job->moves);
+    printf("\n     Nodes: %lld", job->nodes);
+    printf("\n      Time: %lld ms", time);
+    printf("\n       NPS: %lld", job->nodes * 1000 / (time ? time : 1));
+    printf("\n    Games per minute: %.2f\n\n", job->games * 60000.0 / (time ? time : 1));
+    
+    fflush(stdout);
 }
 
-// search position
-int search_position(int depth)
+// find "<command> <file> ..." argument by name (returns text after the name or NULL if not given)
+char *find_argument(char *command, char *name)
 {
-    // init nodes count
-    nodes = 0;
-    
-    // clear PV, killer and history moves
-    memset(pv_table, 0, 16384);  // sizeof(pv_table)
-    memset(killer_moves, 0, 512);  // sizeof(killer_moves)
-    memset(history_moves, 0, 6656);  // sizeof(history_moves)
+    // skip command & file name (file names may contain argument names)
+    int offset = 0;
+    sscanf(command, "%*s %*s%n", &offset);
     
-    // best score
-    int score;
+    char *token = command + offset;
     
-    // iterative deepening
-    for (int current_depth = 1; current_depth <= depth; current_depth++)
-    {    
-        // search position with current depth 3
-	    score = negamax_search(-50000, 50000, current_depth);
-        
-        // output best move
-        printf("info score cp %d depth %d nodes %ld pv ", score, current_depth, nodes);
+    // loop over space separated tokens
+    while (*token)
+    {
+        // token boundaries
+        token += strspn(token, " \t\r\n");
+        size_t length = strcspn(token, " \t\r\n");
         
-        // print PV line
-        for (int i = 0; i < pv_length[0]; i++)
-        {
-            printf("%s%s%c ", square_to_coords[get_move_source(pv_table[0][i])],
-                              square_to_coords[get_move_target(pv_table[0][i])],
-                              promoted_pieces[get_move_piece(pv_table[0][i])]);
-        }
+        // argument found
+        if (length && length == strlen(name) && !strncmp(token, name, length))
+            return token + length;
         
-        printf("\n");
+        // next token
+        token += length;
     }
-	
-	// print best move
-    printf("\nbestmove %s%s%c\n", square_to_coords[get_move_source(pv_table[0][0])],
-                                  square_to_coords[get_move_target(pv_table[0][0])],
-                                  promoted_pieces[get_move_piece(pv_table[0][0])]);
+    
+    // no such argument
+    return NULL;
 }
 
-
-/***********************************************\
-
-              UCI PROTOCOL FUNCTIONS
-
-\***********************************************/
-
-// parse move (from UCI)
-int parse_move(char *move_str)
+// parse "perftsuite <file> [depth <max depth>] [json]" command
+void parse_perft_suite(char *command)
 {
-    // init move list
-	moves move_list[1];
-	
-	// generate moves
-	generate_moves(move_list);
-
-    // parse move string
-	int parse_from = (move_str[0] - 'a') + (8 - (move_str[1] - '0')) * 16;
-	int parse_to = (move_str[2] - 'a') + (8 - (move_str[3] - '0')) * 16;
-	int prom_piece = 0;
+    // init file name
+    char file_name[1024] = "";
+    sscanf(command, "perftsuite %1023s", file_name);
     
-    // init move to encode
-	int move;
-	
-	// loop over generated moves
-	for(int count = 0; count < move_list->count; count++)
-	{
-	    // pick up move
-		move = move_list->moves[count];
-        
-        // if input move is present in the move list
-		if(get_move_source(move) == parse_from && get_move_target(move) == parse_to)
-		{
-		    // init promoted piece
-			prom_piece = get_move_piece(move);
-
-			// if promoted piece is present compare it with promoted piece from user input
-			if(prom_piece)
-			{
-				if((prom_piece == N || prom_piece == n) && move_str[4] == 'n')
-					return move;
-					
-				else if((prom_piece == B || prom_piece == b) && move_str[4] == 'b')
-					return move;
-					
-				else if((prom_piece == R || prom_piece == r) && move_str[4] == 'r')
-					return move;
-					
-				else if((prom_piece == Q || prom_piece == q) && move_str[4] == 'q')
-					return move;
-					
-				continue;
-			}
-            
-            // return move to make on board
-			return move;
-		}
-	}
+    // init max depth (all depths if not given)
+    char *argument = find_argument(command, "depth");
+    int max_depth = argument ? atoi(argument) : 0;
+    
+    // given depth must be positive
+    if (argument && max_depth < 1)
+    {
+        printf("info string perft suite depth must be positive\n");
+        return;
+    }
+    
+    // run perft suite
+    perft_suite(file_name, max_depth, thread_count, find_argument(command, "json") != NULL);
+}
 
-	// return illegal move
-	return 0;
+// parse "epdsolve <file> [threads <threads>] [movetime <ms>] [nodes <nodes>]" command
+void parse_epd_solve(char *command)
+{
+    // init file name
+    char file_name[1024] = "";
+    sscanf(command, "epdsolve %1023s", file_name);
+    
+    // parse arguments
+    char *argument = find_argument(command, "threads");
+    int threads = argument ? atoi(argument) : thread_count;
+    
+    argument = find_argument(command, "movetime");
+    int time_limit = argument ? atoi(argument) : 0;
+    
+    argument = find_argument(command, "nodes");
+    long node_limit = argument ? atol(argument) : 0;
+    
+    // search 1 second per position if no budget is given
+    if (!time_limit && !node_limit)
+        time_limit = 1000;
+    
+    // run EPD solver
+    epd_solve(file_name, threads, time_limit, node_limit);
 }
 
-// input buffer size
-#define inputBuffer (400 * 6)
+// parse "pgnannotate <file> [out <file>] [threads <threads>] [depth <depth>] [nodes <nodes>]" command
+void parse_pgn_annotate(char *command)
+{
+    // init file names
+    char input_name[1024] = "", output_name[1024] = "";
+    sscanf(command, "pgnannotate %1023s", input_name);
+    
+    // parse arguments
+    char *argument = find_argument(command, "out");
+    
+    if (argument)
+        sscanf(argument, "%1023s", output_name);
+    
+    argument = find_argument(command, "threads");
+    int threads = argument ? atoi(argument) : thread_count;
+    
+    argument = find_argument(command, "depth");
+    int depth = argument ? atoi(argument) : 0;
+    
+    argument = find_argument(command, "nodes");
+    long node_limit = argument ? atol(argument) : 0;
+    
+    // search to depth 8 if no limits are given
+    if (depth < 1 || depth >= max_ply)
+        depth = (node_limit ? max_ply - 1 : 8);
+    
+    // run PGN annotator
+    pgn_annotate(input_name, output_name, threads, depth, node_limit);
+}
 
 // UCI driver
 void uci()
@@ -1798,9 +7851,7 @@ void uci()
 	char line[inputBuffer];
 
     // print engine info
-	printf("id name chess_0x88\n");
-	printf("id author Code Monkey King\n");
-	printf("uciok\n");
+	print_engine_info();
 	
 	// main loop
 	while(1)
@@ -1811,21 +7862,66 @@ void uci()
 		// flush stdout
 		fflush(stdout);
 		
-		// skip on no user input
+		// on end of input
 		if(!fgets(line, inputBuffer, stdin))
-			continue;
+		{
+		    // let finite search print its bestmove (infinite one would never end)
+		    if (infinite_search)
+		        stop_search_thread();
+		    else
+		        wait_search();
+		    
+		    // no more commands will come
+			break;
+		}
 	    
 	    // skip on empty user input
 		if(line[0] == '\n')
 			continue;
+		
+		// commands other than "isready", "stop" and "quit" have to wait for running search
+		if (searching && strncmp(line, "isready", 7) && strncmp(line, "stop", 4) && strncmp(line, "quit", 4))
+		{
+		    // infinite search would never end on its own
+		    if (infinite_search)
+		        stop_search_thread();
+		    
+		    // wait for bestmove
+		    else
+		        wait_search();
+		}
 	    
+	    // parse "ucinewgame" command (before "uci" since they share the prefix)
+		if (!strncmp(line, "ucinewgame", 10))
+		{
+		    // init board with initial position
+			parse_fen(start_position);
+			
+			// forget previous game's positions
+			clear_hash_table();
+		}
+		
 	    // pares "uci" command
-		if (!strncmp(line, "uci", 3))
+		else if (!strncmp(line, "uci", 3))
 		{
 		    // print engine info
-			printf("id name chess_0x88\n");
-			printf("id author Code Monkey King\n");
-			printf("uciok\n");
+			print_engine_info();
+		}
+		
+		// parse "debug" command
+		else if (!strncmp(line, "debug", 5))
+		    // switch search statistics output
+		    debug_mode = !strncmp(line + 6, "on", 2);
+		
+		// parse "stats" command
+		else if (!strncmp(line, "stats", 5))
+		{
+		    #ifdef STATS
+		        // print statistics of the last search
+		        print_statistics(&last_search_stats);
+		    #else
+		        printf("info string search statistics are disabled (build with -DSTATS)\n");
+		    #endif
 		}
 		
 		// parse "isready" command
@@ -1836,12 +7932,10 @@ void uci()
 			continue;
 		}
 		
-		// parse "ucinewgame" command
-		else if (!strncmp(line, "ucinewgame", 10))
-		{
-		    // init board with initial position
-			parse_fen(start_position);
-		}
+		// parse "setoption" command
+		else if (!strncmp(line, "setoption", 9))
+		    // set engine option
+		    parse_option(line);
 		
 		// parse GUI input moves after initial position
 		else if(!strncmp(line, "position startpos moves", 23))
@@ -1868,6 +7962,13 @@ void uci()
 				    // go to next move
 					*moves++;
 					
+					// undo stack is full (search needs max_ply more records)
+					if (undo_count >= max_game_ply - max_ply)
+					{
+					    printf("info string too many moves, the rest are ignored\n");
+					    break;
+					}
+					
 					// parse move and make it on board
 					make_move(parse_move(moves), all_moves);
 				}
@@ -1927,6 +8028,13 @@ void uci()
 					    // go to next move
 						*moves++;
 						
+						// undo stack is full (search needs max_ply more records)
+						if (undo_count >= max_game_ply - max_ply)
+						{
+						    printf("info string too many moves, the rest are ignored\n");
+						    break;
+						}
+						
 						// parse current move and make it on board
 						make_move(parse_move(moves), all_moves);
 					}
@@ -1940,28 +8048,60 @@ void uci()
 			print_board();
 		}
 		
-		// parse fixed depth "go" command
-		else if (!strncmp(line, "go depth", 8))
+		// parse "capturetest" command (debug captures generator)
+		else if (!strncmp(line, "capturetest", 11))
+		    // compare captures against full move generator up to given depth
+		    captures_test(atoi(line + 12));
+		
+		// parse "perftsuite" command (batch perft from EPD file)
+		else if (!strncmp(line, "perftsuite", 10))
+		    // run perft suite
+		    parse_perft_suite(line);
+		
+		// parse "epdsolve" command (batch EPD test suite solver)
+		else if (!strncmp(line, "epdsolve", 8))
+		    // run EPD solver
+		    parse_epd_solve(line);
+		
+		// parse "pgnannotate" command (batch PGN annotator)
+		else if (!strncmp(line, "pgnannotate", 11))
+		    // run PGN annotator
+		    parse_pgn_annotate(line);
+		
+		// parse "bench [depth] [nullmove]" command
+		else if (!strncmp(line, "bench", 5))
+		    // run bench with given or default depth (compare with null move off on "nullmove")
+		    bench(atoi(line + 5) > 0 ? atoi(line + 5) : bench_depth, strstr(line, "nullmove") != NULL);
+		
+		// parse "go perft" command
+		else if (!strncmp(line, "go perft", 8))
 		{
-		    // parse "go" command
-			char *go = line;
-			go += 9;
-			
-			// parse depth
-			int depth = *go - '0';
-			
-			// search fixed depth
-			search_position(depth);
+		    // perft needs a positive depth
+		    if (atoi(line + 8) < 1)
+		        printf("info string perft needs a positive depth, e.g. \"go perft 5\"\n");
+		    
+		    // run perft on current position
+		    else
+		        perft_test(atoi(line + 8), thread_count);
 		}
 		
-		// use fixed depth 3 for all the other modes but fixed depth, e.g. in blitz mode
+		// parse "go" command
 		else if (!strncmp(line, "go", 2))
-			// search 6 ply
-			search_position(6);
+		    // start search in the background
+			parse_go(line);
+		
+		// parse "stop" command
+		else if (!strncmp(line, "stop", 4))
+		    // stop search and wait for bestmove
+		    stop_search_thread();
 		
 		// parse "quit" command
 		else if(!strncmp(line, "quit", 4))
+		{
+		    // stop search before leaving
+		    stop_search_thread();
 			break;
+		}
 	}
 }
 
@@ -1973,8 +8113,65 @@ void uci()
 \***********************************************/
 
 // main driver
-int main()
+int main(int argc, char *argv[])
 {
+    // init random hash keys
+    init_hash_keys();
+    
+    // init material + positional score tables
+    init_evaluation();
+    
+    // init 0x88 attack & delta tables
+    init_attack_tables();
+    
+    // init late move reductions table
+    init_reductions();
+    
+    #ifdef BITBOARDS
+        // init leaper & slider pieces attack tables
+        init_bitboards();
+    #endif
+    
+    // init hash table with default size
+    init_hash_table(default_hash_size);
+    
+    // run bench & exit: "wukong bench [depth] [nullmove]"
+    if (argc > 1 && !strcmp(argv[1], "bench"))
+    {
+        // run bench with given or default depth (compare with null move off on "nullmove")
+        bench(argc > 2 && atoi(argv[2]) > 0 ? atoi(argv[2]) : bench_depth,
+              !strcmp(argv[argc - 1], "nullmove"));
+        
+        return 0;
+    }
+    
+    // batch modes: "wukong perftsuite <file> [depth <max depth>] [json]"
+    //              "wukong epdsolve <file> [threads <threads>] [movetime <ms>] [nodes <nodes>]"
+    //              "wukong pgnannotate <file> [out <file>] [threads <threads>] [depth <depth>] [nodes <nodes>]"
+    if (argc > 1 && (!strcmp(argv[1], "perftsuite") || !strcmp(argv[1], "epdsolve") || !strcmp(argv[1], "pgnannotate")))
+    {
+        // join command line arguments into a single command
+        char command[1024] = "";
+        
+        for (int count = 1; count < argc; count++)
+        {
+            strncat(command, argv[count], sizeof(command) - strlen(command) - 2);
+            strcat(command, " ");
+        }
+        
+        // run batch mode
+        if (!strcmp(argv[1], "perftsuite"))
+            parse_perft_suite(command);
+        
+        else if (!strcmp(argv[1], "epdsolve"))
+            parse_epd_solve(command);
+        
+        else
+            parse_pgn_annotate(command);
+        
+        return 0;
+    }
+    
     // run engine in UCI mode
     uci();
     
@@ -0,0 +1,28 @@
+#!/bin/sh
+# PGN annotator test: a position repeated once in the game history is not a draw,
+# only its third occurrence is (usage: annotate_repetition.sh <engine binary>)
+
+engine=${1:-../bin/wukong}
+dir=$(dirname "$0")
+output=$(mktemp)
+
+# annotate both games of the fixture at fixed depth
+echo "pgnannotate $dir/repetition.pgn out $output depth 4" | "$engine" > /dev/null
+
+# join wrapped lines so that moves & comments can be matched together
+text=$(tr '\n' ' ' < "$output")
+rm -f "$output"
+
+fail=0
+
+# twofold repetition (3. Nc3 repeats the position after 1. Nc3) keeps the winning score
+case "$text" in *"3. Nc3 {+"*) ;; *) echo "FAIL: twofold repetition scored as a draw"; fail=1 ;; esac
+
+# threefold repetition (4... Ke8 repeats the starting position the third time) is a draw
+case "$text" in *"4. Nb1?? {+0.00/4}"*) ;; *) echo "FAIL: threefold repetition not scored as a draw"; fail=1 ;; esac
+
+# no other move of the two games is marked as a blunder
+if [ "$(echo "$text" | grep -o '??' | wc -l)" -ne 1 ]; then echo "FAIL: false blunder marks"; fail=1; fi
+
+[ $fail -eq 0 ] && echo "annotate_repetition: passed"
+exit $fail